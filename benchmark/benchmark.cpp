@@ -0,0 +1,878 @@
+#include "../jui.hpp"
+#include <fstream>
+#include <iomanip>
+
+/*
+Measures how the canvas and the widgets scale with large numbers of widgets and long texts. Build it like any other JUI project, for example:
+g++ -O2 -std=c++17 benchmark/benchmark.cpp jui.cpp -lsfml-graphics -lsfml-window -lsfml-system -pthread -o jui-benchmark
+Everything is drawn into an offscreen texture and all input is sent as synthetic events, so no window is ever created. On machines without a display it still needs an OpenGL context, e.g. with xvfb-run and software OpenGL.
+*/
+
+// A single measured value. With --json all results are written to a file at the end, so runs of different versions can be compared by scripts.
+struct Result
+{
+    std::string benchmark;
+    std::string metric;
+    double value;
+    std::string unit;
+};
+std::vector<Result> results;
+
+// Time a piece of code in milliseconds.
+template<typename F>
+float measure(F p_function)
+{
+    sf::Clock clock;
+    p_function();
+    return clock.getElapsedTime().asMicroseconds() / 1000.f;
+}
+
+void printBenchmark(const std::string& p_benchmark, const std::string& p_description)
+{
+    std::cout << p_benchmark << " (" << p_description << ")" << std::endl;
+}
+
+void report(const std::string& p_benchmark, const std::string& p_metric, double p_value, const std::string& p_unit)
+{
+    results.push_back({ p_benchmark, p_metric, p_value, p_unit });
+    std::cout << "\t" << std::left << std::setw(24) << p_metric + ":" << p_value << " " << p_unit << std::endl;
+}
+
+bool writeJson(const std::string& p_path)
+{
+    std::ofstream file(p_path);
+    if(!file) return false;
+
+    file << "{" << std::endl << "    \"results\": [" << std::endl;
+    for (int i = 0; i < results.size(); i++)
+    {
+        const Result& result = results[i];
+        file << "        { \"benchmark\": \"" << result.benchmark << "\", \"metric\": \"" << result.metric << "\", \"value\": " << result.value << ", \"unit\": \"" << result.unit << "\" }";
+        file << (i + 1 < results.size() ? "," : "") << std::endl;
+    }
+    file << "    ]" << std::endl << "}" << std::endl;
+    return true;
+}
+
+sf::Event mouseMoveEvent(int p_x, int p_y)
+{
+    sf::Event event;
+    event.type = sf::Event::MouseMoved;
+    event.mouseMove.x = p_x;
+    event.mouseMove.y = p_y;
+    return event;
+}
+
+sf::Event mouseWheelEvent(float p_delta, int p_x, int p_y)
+{
+    sf::Event event;
+    event.type = sf::Event::MouseWheelScrolled;
+    event.mouseWheelScroll.wheel = sf::Mouse::VerticalWheel;
+    event.mouseWheelScroll.delta = p_delta;
+    event.mouseWheelScroll.x = p_x;
+    event.mouseWheelScroll.y = p_y;
+    return event;
+}
+
+sf::Event textEvent(sf::Uint32 p_unicode)
+{
+    sf::Event event;
+    event.type = sf::Event::TextEntered;
+    event.text.unicode = p_unicode;
+    return event;
+}
+
+void benchmarkLayers(sf::RenderTarget& p_target, int p_widget_count, int p_layer_count)
+{
+    jui::Canvas canvas(p_target);
+    std::vector<jui::Widget*> widgets;
+    widgets.reserve(p_widget_count);
+
+    // Build up the widgets, every widget gets moved to its layer once in its constructor and once with setLayer().
+    float build_time = measure([&]()
+    {
+        for (int i = 0; i < p_widget_count; i++)
+        {
+            jui::Widget* widget = new jui::Widget(canvas);
+            widget->setPosition(sf::Vector2f((i * 37) % 1300, (i * 53) % 700));
+            widget->setSize(sf::Vector2f(40.f, 20.f));
+            widget->setLayer(i % p_layer_count);
+            widgets.push_back(widget);
+        }
+    });
+
+    // Move every widget to another layer.
+    float relayer_time = measure([&]()
+    {
+        for (int i = 0; i < p_widget_count; i++)
+        {
+            widgets[i]->setLayer((i * 7 + 3) % p_layer_count);
+        }
+    });
+
+    // Destroy the widgets in the order they were created.
+    float destroy_time = measure([&]()
+    {
+        for (int i = 0; i < p_widget_count; i++)
+        {
+            delete widgets[i];
+        }
+    });
+
+    printBenchmark("layers", std::to_string(p_widget_count) + " widgets, " + std::to_string(p_layer_count) + " layers");
+    report("layers", "build", build_time, "ms");
+    report("layers", "relayer", relayer_time, "ms");
+    report("layers", "destroy", destroy_time, "ms");
+}
+
+void benchmarkDrawing(sf::RenderTarget& p_target, sf::Font& p_font, int p_widget_count)
+{
+    jui::Canvas canvas(p_target);
+    std::vector<jui::Widget*> widgets;
+
+    // Mix plain widgets with text, so the batch has to switch between untextured quads and the font texture.
+    for (int i = 0; i < p_widget_count; i++)
+    {
+        jui::Widget* widget = i % 4 == 0 ? new jui::TextField(canvas, p_font) : new jui::Widget(canvas);
+        widget->setPosition(sf::Vector2f((i * 37) % 1300, (i * 53) % 700));
+        widget->setSize(sf::Vector2f(40.f, 20.f));
+        widget->setOutlineThickness(1.f);
+        widgets.push_back(widget);
+    }
+
+    const int frame_count = 20;
+    float draw_time = measure([&]()
+    {
+        for (int i = 0; i < frame_count; i++)
+        {
+            canvas.drawAll();
+        }
+    });
+    const jui::QuadBatch::Statistics& statistics = canvas.getBatch().getStatistics();
+
+    printBenchmark("drawing", std::to_string(p_widget_count) + " widgets");
+    report("drawing", "frame", draw_time / frame_count, "ms");
+    report("drawing", "draw_calls", statistics.draw_calls, "calls");
+    report("drawing", "quads", statistics.quads, "quads");
+
+    // With partial redraws only the widget that changes every frame and the widgets overlapping it are drawn.
+    canvas.setPartialRedraw(true);
+    canvas.drawAll();
+    float partial_draw_time = measure([&]()
+    {
+        for (int i = 0; i < frame_count; i++)
+        {
+            widgets[0]->setFillColor(i % 2 == 0 ? sf::Color::Red : sf::Color::White);
+            canvas.drawAll();
+        }
+    });
+
+    report("drawing", "partial_frame", partial_draw_time / frame_count, "ms");
+    report("drawing", "partial_quads", statistics.quads, "quads");
+
+    // Widgets scrolled out of a panel are culled before they are drawn. Only every tenth widget stays inside.
+    canvas.setPartialRedraw(false);
+    jui::Widget panel(canvas);
+    panel.setPosition(sf::Vector2f(0.f, 0.f));
+    panel.setSize(sf::Vector2f(1366.f, 768.f));
+    for (int i = 0; i < widgets.size(); i++)
+    {
+        widgets[i]->setMask(&panel);
+        if(i % 10 != 0) widgets[i]->move(sf::Vector2f(0.f, 2000.f));
+    }
+    canvas.drawAll();
+    float culled_draw_time = measure([&]()
+    {
+        for (int i = 0; i < frame_count; i++)
+        {
+            canvas.drawAll();
+        }
+    });
+
+    report("drawing", "culled_frame", culled_draw_time / frame_count, "ms");
+    report("drawing", "culled_quads", statistics.quads, "quads");
+
+    for (int i = 0; i < widgets.size(); i++)
+    {
+        delete widgets[i];
+    }
+}
+
+void benchmarkCaching(sf::RenderTarget& p_target, sf::Font& p_font, int p_button_count)
+{
+    jui::Canvas canvas(p_target);
+    jui::ScrollList panel(canvas, p_font);
+    panel.setSize(sf::Vector2f(400.f, 700.f));
+    std::vector<jui::Button*> buttons;
+    for (int i = 0; i < p_button_count; i++)
+    {
+        jui::Button* button = new jui::Button(canvas, p_font);
+        panel.add(button);
+        buttons.push_back(button);
+    }
+    panel.listWidgets(jui::Vertical);
+
+    const int frame_count = 20;
+    auto drawFrames = [&]()
+    {
+        for (int i = 0; i < frame_count; i++)
+        {
+            canvas.drawAll();
+            canvas.updateAllLogic();
+        }
+    };
+    float uncached_time = measure(drawFrames);
+    panel.setCached(true);
+    canvas.drawAll();
+    float cached_time = measure(drawFrames);
+
+    printBenchmark("caching", std::to_string(p_button_count) + " buttons in a cached panel");
+    report("caching", "uncached_frame", uncached_time / frame_count, "ms");
+    report("caching", "cached_frame", cached_time / frame_count, "ms");
+    report("caching", "cache_memory", canvas.getCacheMemory() / 1024, "KB");
+
+    for (int i = 0; i < buttons.size(); i++)
+    {
+        delete buttons[i];
+    }
+}
+
+void benchmarkEvents(sf::RenderTarget& p_target, sf::Font& p_font, int p_widget_count)
+{
+    jui::Canvas canvas(p_target);
+    std::vector<jui::Widget*> widgets;
+    for (int i = 0; i < p_widget_count; i++)
+    {
+        jui::Button* button = new jui::Button(canvas, p_font);
+        button->setPosition(sf::Vector2f((i * 37) % 1300, (i * 53) % 700));
+        widgets.push_back(button);
+    }
+
+    // Typing and moving the mouse only concerns the selected and the hovered widget.
+    const int event_count = 10000;
+    float event_time = measure([&]()
+    {
+        for (int i = 0; i < event_count; i++)
+        {
+            sf::Event event = i % 2 == 0 ? textEvent('a') : mouseMoveEvent(i % 1300, i % 700);
+            canvas.updateAllEvents(event);
+        }
+    });
+
+    // Hit testing alone, at positions spread over the whole canvas.
+    const int hit_count = 100000;
+    int hits = 0;
+    float hit_time = measure([&]()
+    {
+        for (int i = 0; i < hit_count; i++)
+        {
+            if(canvas.findWidgetAt(sf::Vector2f((i * 97) % 1366, (i * 61) % 768)) != nullptr) hits++;
+        }
+    });
+
+    printBenchmark("events", std::to_string(p_widget_count) + " buttons");
+    report("events", "per_event", event_time * 1000.f / event_count, "us");
+    report("events", "per_hit_test", hit_time * 1000.f / hit_count, "us");
+    report("events", "hit_ratio", (float)hits / hit_count, "");
+
+    for (int i = 0; i < widgets.size(); i++)
+    {
+        delete widgets[i];
+    }
+}
+
+void benchmarkLogic(sf::RenderTarget& p_target, sf::Font& p_font, int p_widget_count)
+{
+    jui::Canvas canvas(p_target);
+    std::vector<jui::Widget*> widgets;
+    for (int i = 0; i < p_widget_count; i++)
+    {
+        jui::Widget* widget = i % 2 == 0 ? (jui::Widget*)new jui::Button(canvas, p_font) : (jui::Widget*)new jui::InputField(canvas, p_font);
+        widget->setPosition(sf::Vector2f((i * 37) % 1300, (i * 53) % 700));
+        widgets.push_back(widget);
+    }
+    canvas.updateAllLogic();
+
+    // Nothing happens, so no widget should need its logic updated.
+    const int frame_count = 100;
+    float idle_time = measure([&]()
+    {
+        for (int i = 0; i < frame_count; i++)
+        {
+            canvas.updateAllLogic();
+        }
+    });
+
+    // Every widget requested an update, like after a theme change.
+    float full_time = measure([&]()
+    {
+        for (int i = 0; i < frame_count; i++)
+        {
+            for (int j = 0; j < widgets.size(); j++)
+            {
+                widgets[j]->requestUpdate();
+            }
+            canvas.updateAllLogic();
+        }
+    });
+
+    printBenchmark("logic", std::to_string(p_widget_count) + " widgets");
+    report("logic", "idle_frame", idle_time / frame_count, "ms");
+    report("logic", "full_frame", full_time / frame_count, "ms");
+
+    for (int i = 0; i < widgets.size(); i++)
+    {
+        delete widgets[i];
+    }
+}
+
+void benchmarkProfiling(sf::RenderTarget& p_target, sf::Font& p_font, int p_widget_count)
+{
+    jui::Canvas canvas(p_target);
+    std::vector<jui::Widget*> widgets;
+    for (int i = 0; i < p_widget_count; i++)
+    {
+        jui::Button* button = new jui::Button(canvas, p_font);
+        button->setPosition(sf::Vector2f((i * 37) % 1300, (i * 53) % 700));
+        widgets.push_back(button);
+    }
+
+    const int frame_count = 20;
+    auto drawFrames = [&]()
+    {
+        for (int i = 0; i < frame_count; i++)
+        {
+            canvas.drawAll();
+            canvas.updateAllLogic();
+        }
+    };
+    float disabled_time = measure(drawFrames);
+    canvas.setProfiling(true);
+    float enabled_time = measure(drawFrames);
+
+    printBenchmark("profiling", std::to_string(p_widget_count) + " buttons");
+    report("profiling", "disabled_frame", disabled_time / frame_count, "ms");
+    report("profiling", "enabled_frame", enabled_time / frame_count, "ms");
+
+    for (int i = 0; i < widgets.size(); i++)
+    {
+        delete widgets[i];
+    }
+}
+
+void benchmarkTextLayout(sf::RenderTarget& p_target, sf::Font& p_font, int p_character_count)
+{
+    jui::Canvas canvas(p_target);
+    jui::TextField text(canvas, p_font);
+    text.setSize(sf::Vector2f(800.f, 600.f));
+    text.enableWrapping(true);
+
+    // Words of different lengths with a paragraph now and then.
+    sf::String string;
+    for (int i = 0; string.getSize() < p_character_count; i++)
+    {
+        string += sf::String(std::string(1 + i % 9, 'a' + i % 26));
+        string += i % 50 == 49 ? "\n" : " ";
+    }
+
+    // Asking for a character position lays out the text again after every change. Any change except one of the string lays out the whole text.
+    const int layout_count = 10;
+    text.setString(string);
+    float layout_time = measure([&]()
+    {
+        for (int i = 0; i < layout_count; i++)
+        {
+            text.setLineSpacing(i % 2 == 0 ? 1.1f : 1.f);
+            text.findCharacterPos(0);
+        }
+    });
+
+    // Typing into the middle of the text only lays out the lines around the new characters again.
+    const int edit_count = 100;
+    float edit_time = measure([&]()
+    {
+        for (int i = 0; i < edit_count; i++)
+        {
+            text.insert(string.getSize() / 2 + i, i % 6 == 5 ? " " : "x");
+            text.findCharacterPos(0);
+        }
+    });
+
+    // Resizing wraps the text again.
+    float wrap_time = measure([&]()
+    {
+        for (int i = 0; i < layout_count; i++)
+        {
+            text.setSize(sf::Vector2f(400.f + i * 40.f, 600.f));
+            text.findCharacterPos(0);
+        }
+    });
+
+    // Dragging a selection asks for the character under the mouse and for the position of the cursor every frame, without changing the layout.
+    const int query_count = 10000;
+    text.findCharacterPos(0);
+    float query_time = measure([&]()
+    {
+        for (int i = 0; i < query_count; i++)
+        {
+            int index = text.findIndex(sf::Vector2f(i % 800, (i * 7) % 600));
+            text.findCharacterPos(index);
+        }
+    });
+
+    printBenchmark("text_layout", std::to_string(string.getSize()) + " characters");
+    report("text_layout", "layout", layout_time / layout_count, "ms");
+    report("text_layout", "edit", edit_time / edit_count, "ms");
+    report("text_layout", "rewrap", wrap_time / layout_count, "ms");
+    report("text_layout", "query", query_time * 1000.f / query_count, "us");
+}
+
+void benchmarkWordWrap(sf::RenderTarget& p_target, sf::Font& p_font, int p_character_count)
+{
+    jui::Canvas canvas(p_target);
+    jui::TextField text(canvas, p_font);
+    text.setSize(sf::Vector2f(800.f, 600.f));
+    text.enableWrapping(true);
+
+    // Words with long runs without spaces in between, like links and hashes.
+    sf::String string;
+    for (int i = 0; string.getSize() < p_character_count; i++)
+    {
+        if(i % 100 == 99) string += sf::String(std::string(2000 + i % 3000, 'A' + i % 26));
+        else string += sf::String(std::string(1 + i % 9, 'a' + i % 26));
+        string += " ";
+    }
+
+    // The layout takes as long per character for a quarter of the string as for the whole string.
+    float times[2];
+    int sizes[2] = { p_character_count / 4, p_character_count };
+    for (int i = 0; i < 2; i++)
+    {
+        // Changing the line spacing as well lays out the whole string, not only the characters that changed.
+        text.setString(string.substring(0, sizes[i]));
+        text.setLineSpacing(1.f + i * 0.1f);
+        times[i] = measure([&]()
+        {
+            text.findCharacterPos(0);
+        });
+    }
+
+    printBenchmark("word_wrap", std::to_string(p_character_count) + " characters");
+    report("word_wrap", "layout_quarter", times[0], "ms");
+    report("word_wrap", "layout", times[1], "ms");
+    report("word_wrap", "per_character_ratio", (times[1] / sizes[1]) / (times[0] / sizes[0]), "x");
+}
+
+void benchmarkParallelLayout(sf::RenderTarget& p_target, sf::Font& p_font, int p_field_count)
+{
+    jui::Canvas canvas(p_target);
+    std::vector<jui::TextField*> fields;
+    for (int i = 0; i < p_field_count; i++)
+    {
+        jui::TextField* text = new jui::TextField(canvas, p_font);
+        text->setSize(sf::Vector2f(200.f, 60.f));
+        text->setPosition(sf::Vector2f((i % 6) * 220.f, (i / 6 % 12) * 64.f));
+        text->setString("Entry " + std::to_string(i) + " of a long list, with enough words to be wrapped twice");
+        fields.push_back(text);
+    }
+    canvas.drawAll();
+
+    // Changing the character size of every field, like a theme change, lays out all of them in the next frame.
+    const int frame_count = 10;
+    auto relayout = [&]()
+    {
+        for (int i = 0; i < frame_count; i++)
+        {
+            for (jui::TextField* text : fields)
+            {
+                text->setCharacterSize(i % 2 == 0 ? 16 : 15);
+            }
+            canvas.drawAll();
+        }
+    };
+
+    unsigned int thread_count = canvas.getLayoutThreads();
+    canvas.setLayoutThreads(0);
+    float serial_time = measure(relayout);
+    canvas.setLayoutThreads(thread_count);
+    float parallel_time = measure(relayout);
+
+    printBenchmark("parallel_layout", std::to_string(p_field_count) + " text fields, " + std::to_string(thread_count) + " worker threads");
+    report("parallel_layout", "serial_frame", serial_time / frame_count, "ms");
+    report("parallel_layout", "parallel_frame", parallel_time / frame_count, "ms");
+
+    for (int i = 0; i < fields.size(); i++)
+    {
+        delete fields[i];
+    }
+}
+
+void benchmarkGlyphs(sf::RenderTarget& p_target, sf::Font& p_font)
+{
+    jui::Canvas canvas(p_target);
+    jui::TextField text(canvas, p_font);
+    text.setSize(sf::Vector2f(800.f, 600.f));
+
+    // All printable characters of Latin-1, at character sizes no other benchmark uses.
+    const std::vector<jui::Fonts::GlyphRange> ranges = { { 32, 126 }, { 160, 255 } };
+    sf::String string;
+    for (const jui::Fonts::GlyphRange& range : ranges)
+    {
+        for (sf::Uint32 code_point = range.first; code_point <= range.last; code_point++)
+        {
+            string += sf::String(code_point);
+        }
+    }
+    text.setString(string);
+
+    // Without prewarming every glyph is rasterized by the first layout.
+    text.setCharacterSize(37);
+    float cold_time = measure([&]() { text.findCharacterPos(0); });
+
+    float prewarm_time = measure([&]() { jui::Fonts::prewarm(p_font, { 39 }, ranges); });
+    text.setCharacterSize(39);
+    float warm_time = measure([&]() { text.findCharacterPos(0); });
+
+    // Glyphs below 256 are looked up directly in the table of the font, others in a map. Changing the line spacing lays out the whole text again.
+    sf::String latin1_string, cyrillic_string;
+    for (int i = 0; i < 100000; i++)
+    {
+        latin1_string += sf::String((sf::Uint32)(i % 10 == 9 ? ' ' : 'a' + i % 26));
+        cyrillic_string += sf::String((sf::Uint32)(i % 10 == 9 ? ' ' : 0x430 + i % 32));
+    }
+    jui::TextField table_text(canvas, p_font);
+    table_text.setSize(sf::Vector2f(800.f, 600.f));
+    float table_times[2];
+    const sf::String* table_strings[2] = { &latin1_string, &cyrillic_string };
+    for (int i = 0; i < 2; i++)
+    {
+        table_text.setString(*table_strings[i]);
+        table_text.findCharacterPos(0);
+        table_times[i] = measure([&]()
+        {
+            table_text.setLineSpacing(table_text.getLineSpacing() == 1.f ? 1.1f : 1.f);
+            table_text.findCharacterPos(0);
+        });
+    }
+
+    printBenchmark("glyphs", std::to_string(string.getSize()) + " Latin-1 characters");
+    report("glyphs", "cold_layout", cold_time, "ms");
+    report("glyphs", "prewarm", prewarm_time, "ms");
+    report("glyphs", "prewarmed_layout", warm_time, "ms");
+    report("glyphs", "latin1_layout_100k", table_times[0], "ms");
+    report("glyphs", "cyrillic_layout_100k", table_times[1], "ms");
+    for (const jui::Fonts::AtlasStatistics& statistics : jui::Fonts::getAtlasStatistics(p_font))
+    {
+        if(statistics.character_size != 37 && statistics.character_size != 39) continue;
+        std::string size = std::to_string(statistics.character_size);
+        report("glyphs", "misses_" + size, statistics.misses, "glyphs");
+        report("glyphs", "atlas_fill_" + size, statistics.getFill() * 100.f, "%");
+    }
+}
+
+void benchmarkTyping(sf::RenderTarget& p_target, sf::Font& p_font, int p_character_count)
+{
+    jui::Canvas canvas(p_target);
+    jui::InputField inputfield(canvas, p_font);
+    inputfield.setSize(sf::Vector2f(600.f, 40.f));
+    canvas.select(&inputfield);
+    canvas.updateAllLogic();
+
+    // Every character is a frame of its own, like a user typing.
+    float typing_time = measure([&]()
+    {
+        for (int i = 0; i < p_character_count; i++)
+        {
+            sf::Event event = textEvent(i % 10 == 9 ? ' ' : 'a' + i % 26);
+            canvas.updateAllEvents(event);
+            canvas.updateAllLogic();
+            canvas.drawAll();
+        }
+    });
+
+    printBenchmark("typing", std::to_string(p_character_count) + " characters");
+    report("typing", "per_character", typing_time / p_character_count, "ms");
+}
+
+void benchmarkScrolling(sf::RenderTarget& p_target, sf::Font& p_font, int p_item_count)
+{
+    jui::Canvas canvas(p_target);
+    jui::ScrollList scrolllist(canvas, p_font);
+    scrolllist.setSize(sf::Vector2f(400.f, 700.f));
+    std::vector<jui::Button*> items;
+    float build_time = measure([&]()
+    {
+        for (int i = 0; i < p_item_count; i++)
+        {
+            jui::Button* button = new jui::Button(canvas, p_font);
+            button->text.setString("Item " + std::to_string(i));
+            scrolllist.add(button);
+            items.push_back(button);
+        }
+        scrolllist.listWidgets(jui::Vertical);
+    });
+
+    // The list only scrolls while the mouse is over it.
+    sf::Event move_event = mouseMoveEvent(200, 350);
+    canvas.updateAllEvents(move_event);
+
+    const int step_count = 50;
+    float scroll_time = measure([&]()
+    {
+        for (int i = 0; i < step_count; i++)
+        {
+            sf::Event event = mouseWheelEvent(i < step_count / 2 ? -3.f : 3.f, 200, 350);
+            canvas.updateAllEvents(event);
+            canvas.updateAllLogic();
+            canvas.drawAll();
+        }
+    });
+
+    printBenchmark("scrolling", std::to_string(p_item_count) + " items");
+    report("scrolling", "build", build_time, "ms");
+    report("scrolling", "per_step", scroll_time / step_count, "ms");
+
+    float clear_time = measure([&]()
+    {
+        scrolllist.clear();
+        for (int i = 0; i < items.size(); i++)
+        {
+            delete items[i];
+        }
+    });
+    report("scrolling", "destroy", clear_time, "ms");
+}
+
+void benchmarkVirtualList(sf::RenderTarget& p_target, sf::Font& p_font, int p_item_count)
+{
+    jui::Canvas canvas(p_target);
+    jui::ScrollList scrolllist(canvas, p_font);
+    scrolllist.setSize(sf::Vector2f(400.f, 700.f));
+    int created_rows = 0;
+    float build_time = measure([&]()
+    {
+        scrolllist.setVirtualItems(p_item_count, [](int p_index) { return p_index % 10 == 0 ? 60.f : 40.f; }, [&]()
+        {
+            created_rows++;
+            return new jui::Button(canvas, p_font);
+        }, [](jui::Widget* p_row, int p_index)
+        {
+            static_cast<jui::Button*>(p_row)->text.setString("Item " + std::to_string(p_index));
+        });
+    });
+
+    sf::Event move_event = mouseMoveEvent(200, 350);
+    canvas.updateAllEvents(move_event);
+
+    const int step_count = 50;
+    float scroll_time = measure([&]()
+    {
+        for (int i = 0; i < step_count; i++)
+        {
+            sf::Event event = mouseWheelEvent(i < step_count / 2 ? -3.f : 3.f, 200, 350);
+            canvas.updateAllEvents(event);
+            canvas.updateAllLogic();
+            canvas.drawAll();
+        }
+    });
+    // Jumping far away rebinds every row.
+    float jump_time = measure([&]()
+    {
+        for (int i = 0; i < step_count; i++)
+        {
+            scrolllist.scrollToItem((i * 7919) % p_item_count);
+            canvas.drawAll();
+        }
+    });
+
+    printBenchmark("virtual_list", std::to_string(p_item_count) + " items");
+    report("virtual_list", "build", build_time, "ms");
+    report("virtual_list", "per_step", scroll_time / step_count, "ms");
+    report("virtual_list", "per_jump", jump_time / step_count, "ms");
+    report("virtual_list", "rows", created_rows, "widgets");
+}
+
+void benchmarkLayoutEngine(sf::RenderTarget& p_target, sf::Font& p_font, int p_row_count)
+{
+    jui::Canvas canvas(p_target);
+    jui::LayoutGroup form(canvas);
+    std::vector<jui::LayoutGroup*> rows;
+    std::vector<jui::Widget*> widgets;
+    float build_time = measure([&]()
+    {
+        form.setLayout(jui::StackLayout, jui::Vertical, 4.f);
+        for (int i = 0; i < p_row_count; i++)
+        {
+            // A label, an input field that takes the free space, and two buttons in every row.
+            jui::LayoutGroup* row = new jui::LayoutGroup(canvas);
+            row->setLayout(jui::FlexLayout, jui::Horizontal, 4.f);
+            row->setPreferredSize(sf::Vector2f(800.f, -1.f));
+            for (int j = 0; j < 4; j++)
+            {
+                jui::Widget* widget = new jui::Widget(canvas);
+                widget->setSize(sf::Vector2f(j == 0 ? 150.f : 80.f, 30.f));
+                if(j == 1) widget->setFlexGrow(1.f);
+                row->add(widget);
+                widgets.push_back(widget);
+            }
+            form.add(row);
+            rows.push_back(row);
+        }
+        form.updateLayout();
+    });
+
+    // Changing a single widget only measures the groups around it again.
+    const int change_count = 100;
+    float relayout_time = measure([&]()
+    {
+        for (int i = 0; i < change_count; i++)
+        {
+            widgets[(i * 7919) % widgets.size()]->setPreferredSize(sf::Vector2f(100.f, 30.f + i % 2));
+            form.updateLayout();
+        }
+    });
+
+    printBenchmark("layout_engine", std::to_string(p_row_count * 5) + " widgets in " + std::to_string(p_row_count) + " rows");
+    report("layout_engine", "build", build_time, "ms");
+    report("layout_engine", "relayout_one", relayout_time / change_count, "ms");
+
+    for (int i = 0; i < widgets.size(); i++)
+    {
+        delete widgets[i];
+    }
+    for (int i = 0; i < rows.size(); i++)
+    {
+        delete rows[i];
+    }
+}
+
+void benchmarkResizing(sf::RenderTarget& p_target, sf::Font& p_font, int p_widget_count)
+{
+    jui::Canvas canvas(p_target);
+    std::vector<jui::Widget*> widgets;
+    for (int i = 0; i < p_widget_count; i++)
+    {
+        // Every tenth widget is a text field anchored to the right edge.
+        if(i % 10 == 0)
+        {
+            jui::TextField* text = new jui::TextField(canvas, p_font);
+            text->setString("Anchored " + std::to_string(i));
+            text->setPosition(sf::Vector2f(1166.f, (i / 10) % 700));
+            text->setAnchor(sf::FloatRect(1.f, 0.f, 0.f, 0.f));
+            widgets.push_back(text);
+        }
+        else
+        {
+            jui::Widget* widget = new jui::Widget(canvas);
+            widget->setPosition(sf::Vector2f((i * 37) % 1200, (i * 53) % 700));
+            widgets.push_back(widget);
+        }
+    }
+    canvas.drawAll();
+
+    // Dragging the border of a window sends many resize events per frame.
+    const int frame_count = 20;
+    const int events_per_frame = 10;
+    float resize_time = measure([&]()
+    {
+        for (int i = 0; i < frame_count; i++)
+        {
+            for (int j = 0; j < events_per_frame; j++)
+            {
+                sf::Event event;
+                event.type = sf::Event::Resized;
+                event.size.width = p_target.getSize().x;
+                event.size.height = p_target.getSize().y;
+                canvas.updateAllEvents(event);
+            }
+            canvas.drawAll();
+        }
+    });
+
+    printBenchmark("resizing", std::to_string(p_widget_count) + " widgets, " + std::to_string(events_per_frame) + " resize events per frame");
+    report("resizing", "per_frame", resize_time / frame_count, "ms");
+
+    for (int i = 0; i < widgets.size(); i++)
+    {
+        delete widgets[i];
+    }
+}
+
+void benchmarkDropDownList(sf::RenderTarget& p_target, sf::Font& p_font, int p_element_count)
+{
+    jui::Canvas canvas(p_target);
+    jui::DropDownList dropdownlist(canvas, p_font);
+
+    std::vector<sf::String> elements;
+    for (int i = 0; i < p_element_count; i++)
+    {
+        elements.push_back("Element " + std::to_string(i));
+    }
+
+    float fill_time = measure([&]() { dropdownlist.setList(elements); });
+    // Replacing the list rebinds the buttons in view.
+    float replace_time = measure([&]() { dropdownlist.setList(elements); });
+    float clear_time = measure([&]() { dropdownlist.setList({}); });
+
+    printBenchmark("dropdownlist", std::to_string(p_element_count) + " elements");
+    report("dropdownlist", "fill", fill_time, "ms");
+    report("dropdownlist", "replace", replace_time, "ms");
+    report("dropdownlist", "clear", clear_time, "ms");
+}
+
+// Usage: jui-benchmark [--json <result file>] [font file]
+int main(int argc, char** argv)
+{
+    std::string json_path;
+    std::string font_path;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if(argument == "--json" && i + 1 < argc)
+        {
+            json_path = argv[++i];
+        }
+        else
+        {
+            font_path = argument;
+        }
+    }
+
+    sf::RenderTexture target;
+    if(!target.create(1366, 768))
+    {
+        std::cout << "Failed to create the render texture!" << std::endl;
+        return 1;
+    }
+
+    // Without a font file text is laid out with empty glyphs, which still exercises everything except the glyph lookups.
+    if(font_path.size() > 0)
+    {
+        jui::Fonts::load("Benchmark", font_path);
+    }
+    sf::Font& font = jui::Fonts::get("Benchmark");
+
+    benchmarkLayers(target, 100000, 16);
+    benchmarkDrawing(target, font, 10000);
+    benchmarkCaching(target, font, 2000);
+    benchmarkEvents(target, font, 5000);
+    benchmarkLogic(target, font, 10000);
+    benchmarkProfiling(target, font, 3000);
+    benchmarkTextLayout(target, font, 100000);
+    benchmarkWordWrap(target, font, 1000000);
+    benchmarkParallelLayout(target, font, 2000);
+    benchmarkGlyphs(target, font);
+    benchmarkTyping(target, font, 2000);
+    benchmarkScrolling(target, font, 10000);
+    benchmarkVirtualList(target, font, 1000000);
+    benchmarkDropDownList(target, font, 20000);
+    benchmarkLayoutEngine(target, font, 1000);
+    benchmarkResizing(target, font, 5000);
+
+    if(json_path.size() > 0 && !writeJson(json_path))
+    {
+        std::cout << "Failed to write the results to " << json_path << "!" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,12 +1,13 @@
 #include "jui.hpp"
 #include <vector>
+#include <algorithm>
 
 namespace jui
 {
     Widget::Widget(Canvas& p_canvas)
         : position(sf::Vector2f(100.f, 100.f)), 
         size(sf::Vector2f(100.f, 100.f)),
-        window(p_canvas.window), 
+        target(p_canvas.target), 
         canvas(p_canvas)
     {
         setPosition(sf::Vector2f(0.f, 0.f));
@@ -15,12 +16,26 @@ namespace jui
         setOutlineColor(sf::Color(170, 170, 170));
 
         p_canvas.add(this);
+        requestUpdate();
     }
     
     Widget::~Widget() 
     {
+        // Widgets masked to this widget are not clipped by it anymore.
+        Widget::setMask(nullptr);
+        while(masked_widgets.size() > 0)
+        {
+            masked_widgets.back()->Widget::setMask(nullptr);
+        }
+        if(group != nullptr) group->remove(this);
+        if(anchored_position != -1) canvas.removeAnchored(this);
         canvas.remove(this);
     }
+
+    const char* Widget::getTypeName() const
+    {
+        return "Widget";
+    }
     
     void Widget::move(const sf::Vector2f& p_offset) 
     {
@@ -29,14 +44,26 @@ namespace jui
     
     void Widget::setPosition(const sf::Vector2f& p_position) 
     {
+        if(position != p_position)
+        {
+            invalidate();
+            if(group != nullptr) group->refreshBounds(sf::FloatRect(position, size), sf::FloatRect(p_position, size));
+        }
         position = p_position;
+        if(anchored_position != -1 && !canvas.applying_anchors) refreshAnchorOffsets();
         background.setPosition(position.x + background.getOutlineThickness(), position.y + background.getOutlineThickness());
         refreshView();
     }
     
     void Widget::setSize(const sf::Vector2f& p_size) 
     {
+        if(size != p_size)
+        {
+            invalidate();
+            if(group != nullptr) group->refreshBounds(sf::FloatRect(position, size), sf::FloatRect(position, p_size));
+        }
         size = p_size;
+        if(anchored_position != -1 && !canvas.applying_anchors) refreshAnchorOffsets();
         background.setSize(sf::Vector2f(size.x - background.getOutlineThickness() * 2.f, size.y - background.getOutlineThickness() * 2.f));
         refreshView();
     }
@@ -53,36 +80,163 @@ namespace jui
     
     void Widget::draw() const
     {
-        if(mask != nullptr)
+        // Widgets are drawn to the bounds of their mask, or their own bounds if they do not have one.
+        const sf::FloatRect& clip = mask != nullptr ? mask->getClippedBounds() : clipped_bounds;
+        QuadBatch& batch = canvas.getBatch();
+
+        // Fill.
+        sf::FloatRect fill_rect(background.getPosition(), background.getSize());
+        if(background.getTexture() != nullptr)
         {
-            window.setView(mask->getView());
+            batch.addTexturedRectangle(fill_rect, sf::FloatRect(background.getTextureRect()), background.getTexture(), background.getFillColor(), clip);
         }
-        else
+        else if(background.getFillColor().a != 0)
         {
-            window.setView(view);
+            batch.addRectangle(fill_rect, background.getFillColor(), clip);
         }
 
-        // Draw.
-        window.draw(background);
+        // Outline. A positive thickness grows the outline outwards, a negative one inwards.
+        float thickness = background.getOutlineThickness();
+        if(thickness != 0.f && background.getOutlineColor().a != 0)
+        {
+            sf::FloatRect outer = fill_rect;
+            sf::FloatRect inner = fill_rect;
+            if(thickness > 0.f)
+            {
+                outer = sf::FloatRect(fill_rect.left - thickness, fill_rect.top - thickness, fill_rect.width + thickness * 2.f, fill_rect.height + thickness * 2.f);
+            }
+            else
+            {
+                inner = sf::FloatRect(fill_rect.left - thickness, fill_rect.top - thickness, fill_rect.width + thickness * 2.f, fill_rect.height + thickness * 2.f);
+            }
+            float inner_bottom = inner.top + inner.height;
+            float outer_bottom = outer.top + outer.height;
+            batch.addRectangle(sf::FloatRect(outer.left, outer.top, outer.width, inner.top - outer.top), background.getOutlineColor(), clip);
+            batch.addRectangle(sf::FloatRect(outer.left, inner_bottom, outer.width, outer_bottom - inner_bottom), background.getOutlineColor(), clip);
+            batch.addRectangle(sf::FloatRect(outer.left, inner.top, inner.left - outer.left, inner.height), background.getOutlineColor(), clip);
+            batch.addRectangle(sf::FloatRect(inner.left + inner.width, inner.top, outer.left + outer.width - (inner.left + inner.width), inner.height), background.getOutlineColor(), clip);
+        }
     }
     
     void Widget::updateLogic() 
     {
-        // If the mask gets resized, the child wouldn't follow, because it isn't updated/positioned. Calling this always makes sure all widgets are up to date. (Solve differently?)
-        refreshView();
+        // Views follow their masks in refreshView(), so there is nothing to update every frame.
+    }
+
+    void Widget::requestUpdate()
+    {
+        if(update_queue_position != -1) return;
+
+        update_queue_position = canvas.update_queue.size();
+        canvas.update_queue.push_back(this);
+    }
+
+    void Widget::scheduleUpdate(float p_delay)
+    {
+        float time = canvas.timer_clock.getElapsedTime().asSeconds() + std::max(p_delay, 0.f);
+        if(scheduled_update_time >= 0.f && scheduled_update_time <= time) return;
+
+        scheduled_update_time = time;
+        canvas.schedule(this);
+    }
+
+    void Widget::setUpdatedEveryFrame(bool p_state)
+    {
+        if(isUpdatedEveryFrame() == p_state) return;
+
+        if(p_state)
+        {
+            every_frame_position = canvas.every_frame_widgets.size();
+            canvas.every_frame_widgets.push_back(this);
+        }
+        else
+        {
+            canvas.every_frame_widgets[every_frame_position] = nullptr;
+            every_frame_position = -1;
+        }
+    }
+
+    bool Widget::isUpdatedEveryFrame() const
+    {
+        return every_frame_position != -1;
     }
     
     void Widget::updateEvents(sf::Event& p_event) 
     {
     }
+
+    void Widget::setEventSubscription(unsigned int p_routed, unsigned int p_global)
+    {
+        // Other events are meant for all widgets anyway.
+        if(p_routed & OtherEvents) p_global |= OtherEvents;
+        routed_events = p_routed;
+
+        for (int i = 0; i < Canvas::s_event_category_count; i++)
+        {
+            unsigned int category = 1 << i;
+            if((p_global & category) == (global_events & category)) continue;
+
+            std::vector<Widget*>& subscribers = canvas.global_subscribers[i];
+            if(p_global & category)
+            {
+                subscriber_positions[i] = subscribers.size();
+                subscribers.push_back(this);
+            }
+            else if(subscriber_positions[i] != -1)
+            {
+                subscribers[subscriber_positions[i]] = nullptr;
+                subscriber_positions[i] = -1;
+            }
+        }
+        global_events = p_global;
+    }
+
+    void Widget::invalidate()
+    {
+        canvas.redraw_needed = true;
+
+        // The caches of this widget and of all its masks still show the old look of this widget.
+        for (Widget* widget = this; widget != nullptr; widget = widget->mask)
+        {
+            if(widget->is_cached)
+            {
+                widget->is_cache_valid = false;
+                widget->invalidateDrawnArea();
+            }
+        }
+        invalidateDrawnArea();
+    }
+
+    void Widget::profileGeometryRebuild() const
+    {
+        if(canvas.profiling) canvas.getProfile(this).geometry_rebuilds++;
+    }
+
+    void Widget::setOverflowBounds(const sf::FloatRect& p_bounds) const
+    {
+        overflow_bounds = p_bounds;
+        canvas.refreshSlot(this);
+    }
+
+    void Widget::invalidateDrawnArea()
+    {
+        // A widget that was invalidated before already marked the area it was drawn to in the last frame.
+        if(!canvas.partial_redraw || canvas_slot == -1 || invalidated_position != -1) return;
+
+        invalidated_position = canvas.invalidated_widgets.size();
+        canvas.invalidated_widgets.push_back(this);
+        canvas.invalidate(drawn_bounds);
+    }
     
     void Widget::setOutlineColor(const sf::Color& p_color) 
     {
+        if(background.getOutlineColor() != p_color) invalidate();
         background.setOutlineColor(p_color);
     }
     
     void Widget::setOutlineThickness(float p_thickness)
     {
+        if(background.getOutlineThickness() != p_thickness) invalidate();
         background.setOutlineThickness(p_thickness);
         background.setPosition(position.x + background.getOutlineThickness(), position.y + background.getOutlineThickness());
         background.setSize(sf::Vector2f(size.x - background.getOutlineThickness() * 2.f, size.y - background.getOutlineThickness() * 2.f));
@@ -90,22 +244,137 @@ namespace jui
 
     void Widget::setFillColor(const sf::Color& p_color) 
     {
+        // Widgets like buttons set their color every frame, which should only cause a redraw when the color actually changes.
+        if(background.getFillColor() != p_color) invalidate();
         background.setFillColor(p_color);
     }
 
     void Widget::setTexture(const sf::Texture* p_texture, const sf::IntRect& p_texture_rect)
     {
+        invalidate();
         background.setTextureRect(p_texture_rect);
         background.setTexture(p_texture);
     }
     void Widget::setTexture(const sf::Texture* p_texture)
     {
+        invalidate();
         background.setTexture(p_texture);
     }
 
+    void Widget::setAnchor(const sf::FloatRect& p_anchor)
+    {
+        anchor = p_anchor;
+        // The default anchor keeps the widget where it is, like widgets without one.
+        if(anchor != sf::FloatRect())
+        {
+            if(anchored_position == -1) canvas.addAnchored(this);
+            refreshAnchorOffsets();
+        }
+        else if(anchored_position != -1)
+        {
+            canvas.removeAnchored(this);
+        }
+    }
+
+    const sf::FloatRect& Widget::getAnchor()
+    {
+        return anchor;
+    }
+
+    void Widget::refreshAnchorOffsets()
+    {
+        sf::Vector2f canvas_size(canvas.getBounds().width, canvas.getBounds().height);
+        anchor_offset = position - sf::Vector2f(anchor.left * canvas_size.x, anchor.top * canvas_size.y);
+        anchor_end_offset = position + size - sf::Vector2f((anchor.left + anchor.width) * canvas_size.x, (anchor.top + anchor.height) * canvas_size.y);
+    }
+
+    void Widget::applyAnchor(const sf::Vector2f& p_canvas_size)
+    {
+        sf::Vector2f start = sf::Vector2f(anchor.left * p_canvas_size.x, anchor.top * p_canvas_size.y) + anchor_offset;
+        sf::Vector2f end = sf::Vector2f((anchor.left + anchor.width) * p_canvas_size.x, (anchor.top + anchor.height) * p_canvas_size.y) + anchor_end_offset;
+        if(end - start != size) setSize(end - start);
+        if(start != position) setPosition(start);
+    }
+
+    void Widget::setPreferredSize(const sf::Vector2f& p_size)
+    {
+        if(preferred_size == p_size) return;
+        preferred_size = p_size;
+        invalidateLayout();
+    }
+
+    const sf::Vector2f& Widget::getPreferredSize() const
+    {
+        return preferred_size;
+    }
+
+    void Widget::setMinSize(const sf::Vector2f& p_size)
+    {
+        if(min_size == p_size) return;
+        min_size = p_size;
+        invalidateLayout();
+    }
+
+    const sf::Vector2f& Widget::getMinSize() const
+    {
+        return min_size;
+    }
+
+    void Widget::setMaxSize(const sf::Vector2f& p_size)
+    {
+        if(max_size == p_size) return;
+        max_size = p_size;
+        invalidateLayout();
+    }
+
+    const sf::Vector2f& Widget::getMaxSize() const
+    {
+        return max_size;
+    }
+
+    void Widget::setFlexGrow(float p_factor)
+    {
+        if(flex_grow == p_factor) return;
+        flex_grow = p_factor;
+        invalidateLayout();
+    }
+
+    float Widget::getFlexGrow() const
+    {
+        return flex_grow;
+    }
+
+    sf::Vector2f Widget::measure()
+    {
+        return clampSize(sf::Vector2f(preferred_size.x >= 0.f ? preferred_size.x : size.x, preferred_size.y >= 0.f ? preferred_size.y : size.y));
+    }
+
+    void Widget::invalidateLayout()
+    {
+        // Mark the groups on the way to the outermost group with a layout. A group that is already marked was passed before, and the groups around it are marked as well.
+        LayoutGroup* outermost = nullptr;
+        for (LayoutGroup* current = group; current != nullptr && current->layout != ManualLayout; current = current->group)
+        {
+            if(!current->measure_valid) return;
+            current->measure_valid = false;
+            current->arrange_needed = true;
+            outermost = current;
+        }
+        if(outermost != nullptr) canvas.requestArrange(outermost);
+    }
+
+    sf::Vector2f Widget::clampSize(const sf::Vector2f& p_size) const
+    {
+        return sf::Vector2f(std::min(std::max(p_size.x, min_size.x), max_size.x), std::min(std::max(p_size.y, min_size.y), max_size.y));
+    }
+
     void Widget::setVisible(bool p_state)
     {
+        if(is_visible != p_state) invalidate();
+        if(!is_visible && p_state) requestUpdate();
         is_visible = p_state;
+        canvas.refreshHitGrid(this);
+        canvas.refreshSlot(this);
     }
 
     bool Widget::isVisible()
@@ -115,6 +384,8 @@ namespace jui
 
     void Widget::setUpdated(bool p_state)
     {
+        // The widget might have missed changes while it was not updated.
+        if(!is_updated && p_state) requestUpdate();
         is_updated = p_state;
     }
 
@@ -126,6 +397,8 @@ namespace jui
     void Widget::setSelectable(bool p_state)
     {
         is_selectable = p_state;
+        canvas.refreshHitGrid(this);
+        canvas.refreshSlot(this);
     }
 
     bool Widget::isSelectable()
@@ -184,22 +457,24 @@ namespace jui
 
     void Widget::refreshView() 
     {
+        canvas.refreshClipping(this, false);
+    }
+
+    bool Widget::clipToMask()
+    {
+        // Store how the view should normally look.
+        sf::Vector2f view_position = position;
+        sf::Vector2f view_size = size;
+
+        // Widgets with a negative size do not cover anything.
         if(size.x < 0 || size.y < 0)
         {
-            view.reset(sf::FloatRect(position, sf::Vector2f()));
-	        view.setViewport(sf::FloatRect(position.x/window.getSize().x, position.y/window.getSize().y, 0.f, 0.f));
-            return;
+            view_size = sf::Vector2f();
         }
-
-        // With mask. This requires to also apply the clipping done by outer masks, more info above the definition of setMask().
-        if(mask != nullptr)
+        // With mask. The mask's clipped bounds already contain the clipping done by outer masks, more info above the definition of setMask().
+        else if(mask != nullptr)
         {
-            // Store how the view should normally look.
-            sf::Vector2f view_position = position;
-            sf::Vector2f view_size = size;
-
-            sf::FloatRect mask_bounds = sf::FloatRect(mask->getView().getViewport().left * window.getSize().x, mask->getView().getViewport().top * window.getSize().y,
-                                                        mask->getView().getViewport().width * window.getSize().x, mask->getView().getViewport().height * window.getSize().y);
+            const sf::FloatRect& mask_bounds = mask->clipped_bounds;
 
             // Check if the child is outside of the mask, then resize and reposition it to fit the bounds.
             if(mask_bounds.left > position.x)
@@ -235,31 +510,49 @@ namespace jui
                 view_size.y = mask_bounds.height;
                 view_position.y = mask_bounds.top;
             }
-
-            // Apply the new position and size to the view.
-            view.reset(sf::FloatRect(view_position, view_size));
-	        view.setViewport(sf::FloatRect(view_position.x/window.getSize().x, view_position.y/window.getSize().y, view_size.x/window.getSize().x, view_size.y/window.getSize().y));
-            return;
         }
 
-        // Without mask.
-        view.reset(sf::FloatRect(position, size));
-	    view.setViewport(sf::FloatRect(position.x/window.getSize().x, position.y/window.getSize().y, size.x/window.getSize().x, size.y/window.getSize().y));
+        // Apply the new position and size to the view.
+        view.reset(sf::FloatRect(view_position, view_size));
+	    view.setViewport(sf::FloatRect(view_position.x/target.getSize().x, view_position.y/target.getSize().y, view_size.x/target.getSize().x, view_size.y/target.getSize().y));
+
+        // The view now covers exactly the part of the widget that is not clipped, which is also the area the widget can be hit in.
+        sf::FloatRect bounds(view_position, view_size);
+        bool changed = clipped_bounds != bounds;
+        if(changed) invalidate();
+        clipped_bounds = bounds;
+        canvas.refreshHitGrid(this);
+        canvas.refreshSlot(this);
+        return changed;
     }
     
     bool Widget::mouseOver() 
     {
-        bool mouse_over = sf::FloatRect(position, size).contains(getMousePosition(window, &view)); 
-        if(mask != nullptr)
-        {
-            return mouse_over && mask->mouseOver();
-        }
-        return mouse_over;
+        // The clipped bounds already contain the clipping of all masks.
+        return clipped_bounds.contains(canvas.getMousePosition());
     }
     
     void Widget::setMask(Widget* p_mask) 
     {
+        if(mask == p_mask) 
+        {
+            refreshView();
+            return;
+        }
+
+        // Both the caches of the old and the new masks change.
+        invalidate();
+        if(mask != nullptr)
+        {
+            mask->masked_widgets.erase(std::find(mask->masked_widgets.begin(), mask->masked_widgets.end(), this));
+        }
         mask = p_mask;
+        if(mask != nullptr)
+        {
+            mask->masked_widgets.push_back(this);
+        }
+        invalidate();
+        refreshView();
     }
 
     Widget* Widget::getMask() const
@@ -272,11 +565,44 @@ namespace jui
         return view;
     }
 
+    const sf::FloatRect& Widget::getClippedBounds() const
+    {
+        return clipped_bounds;
+    }
+
+    void Widget::setCached(bool p_state)
+    {
+        if(is_cached == p_state) return;
+
+        invalidate();
+        is_cached = p_state;
+        if(is_cached)
+        {
+            canvas.addCached(this);
+            is_cache_valid = false;
+        }
+        else
+        {
+            canvas.releaseCache(this);
+            canvas.removeCached(this);
+        }
+    }
+
+    bool Widget::isCached() const
+    {
+        return is_cached;
+    }
+
     Graphic::Graphic(Canvas& p_canvas) : Widget(p_canvas)
     {
         setSize(sf::Vector2f(100.f, 100.f));
     }
 
+    const char* Graphic::getTypeName() const
+    {
+        return "Graphic";
+    }
+
     void Graphic::setPreserveAspect(bool p_state)
     {
         preserve_aspect = p_state;
@@ -328,22 +654,58 @@ namespace jui
         vertical_alignment(Left), 
         overflow_type(Overflow),
         wrapping(true),
-        vertices(sf::Triangles),
-        geometry_need_update(true),
-        selection_color(sf::Color(0, 0, 255, 100)),
-        selection_vertices(sf::Triangles)
+        geometry_need_update(false),
+        selection_color(sf::Color(0, 0, 255, 100))
     {
         setOutlineColor(sf::Color(170, 170, 170));
         setOutlineThickness(1.f);
+        requestLayout();
+    }
+
+    TextField::~TextField()
+    {
+        if(pending_layout_position != -1) canvas.cancelLayout(this);
+    }
+
+    const char* TextField::getTypeName() const
+    {
+        return "TextField";
     }
 
     void TextField::setString(const sf::String& p_string)
     {
-        if(string != p_string)
-        {
-            string = p_string;
-            geometry_need_update = true;
-        }
+        // Usually only a few characters were typed or deleted, so find the part of the string that changed.
+        int common_size = std::min(string.getSize(), p_string.getSize());
+        int prefix = 0;
+        while(prefix < common_size && string[prefix] == p_string[prefix]) prefix++;
+        if(prefix == string.getSize() && prefix == p_string.getSize()) return;
+
+        int suffix = 0;
+        while(suffix < common_size - prefix && string[string.getSize() - 1 - suffix] == p_string[p_string.getSize() - 1 - suffix]) suffix++;
+
+        string = p_string;
+        requestLayout(prefix, suffix);
+        invalidate();
+    }
+
+    void TextField::insert(int p_index, const sf::String& p_string)
+    {
+        if(p_string.isEmpty()) return;
+
+        int suffix = string.getSize() - p_index;
+        string.insert(p_index, p_string);
+        requestLayout(p_index, suffix);
+        invalidate();
+    }
+
+    void TextField::erase(int p_index, int p_count)
+    {
+        if(p_count <= 0) return;
+
+        int suffix = string.getSize() - p_index - p_count;
+        string.erase(p_index, p_count);
+        requestLayout(p_index, suffix);
+        invalidate();
     }
 
     void TextField::setFont(const sf::Font& p_font)
@@ -351,7 +713,10 @@ namespace jui
         if(&font != &p_font)
         {
             font = p_font;
-            geometry_need_update = true;
+            // The glyphs known for the font belong to the one assigned before. They are read again, so other text fields using the font still find all of theirs.
+            Fonts::reloadGlyphTables(font);
+            requestLayout();
+            invalidate();
         }
     }
 
@@ -360,7 +725,8 @@ namespace jui
         if(character_size != p_size)
         {
             character_size = p_size;
-            geometry_need_update = true;
+            requestLayout();
+            invalidate();
         }
     }
 
@@ -369,7 +735,8 @@ namespace jui
         if(line_spacing_factor != p_spacing_factor)
         {
             line_spacing_factor = p_spacing_factor;
-            geometry_need_update = true;
+            requestLayout();
+            invalidate();
         }   
     }
 
@@ -378,7 +745,8 @@ namespace jui
         if(paragraph_spacing_factor != p_spacing_factor)
         {
             paragraph_spacing_factor = p_spacing_factor;
-            geometry_need_update = true;
+            requestLayout();
+            invalidate();
         }   
     }
 
@@ -387,14 +755,17 @@ namespace jui
         if(text_color != p_color)
         {
             text_color = p_color;
+            invalidate();
 
             // Change vertex colors directly, no need to update whole geometry
             // (if geometry is updated anyway, we can skip this step)
             if (!geometry_need_update)
             {
-                for (std::size_t i = 0; i < vertices.getVertexCount(); ++i)
-                    vertices[i].color = text_color;
+                for (std::size_t i = 0; i < geometry.vertices.getVertexCount(); ++i)
+                    geometry.vertices[i].color = text_color;
             }
+            // The lines a pending edit does not lay out again would keep the old color.
+            else whole_text_changed = true;
         }
     }
 
@@ -403,7 +774,8 @@ namespace jui
         if(overflow_type != p_type)
         {
             overflow_type = p_type;
-            geometry_need_update = true;
+            requestLayout();
+            invalidate();
         }
     }
 
@@ -412,7 +784,8 @@ namespace jui
         if(wrapping != p_state)
         {
             wrapping = p_state;
-            geometry_need_update = true;
+            requestLayout();
+            invalidate();
         }
     }
 
@@ -421,7 +794,8 @@ namespace jui
         if(horizontal_alignment != p_type)
         {
             horizontal_alignment = p_type;
-            geometry_need_update = true;
+            requestLayout();
+            invalidate();
         }
     }
 
@@ -430,7 +804,8 @@ namespace jui
         if(vertical_alignment != p_type)
         {
             vertical_alignment = p_type;
-            geometry_need_update = true;
+            requestLayout();
+            invalidate();
         }
     }
 
@@ -441,9 +816,10 @@ namespace jui
         {
             Widget::setPosition(p_position);
 
+            // The text is laid out relative to the text field, so moving it, e.g. while scrolling, only moves the text instead of laying it out again.
             text_transform = sf::Transform::Identity;
             text_transform.translate(p_position);
-            geometry_need_update = true;
+            if(!geometry_need_update) setOverflowBounds(text_transform.transformRect(geometry.quad_bounds));
         }
     }
 
@@ -452,7 +828,8 @@ namespace jui
         if(getSize() != p_size)
         {
             Widget::setSize(p_size);
-            geometry_need_update = true;
+            requestLayout();
+            invalidate();
         }
     }
 
@@ -506,7 +883,9 @@ namespace jui
         {
             start_selection = p_start;
             end_selection = p_end;
-            geometry_need_update = true;
+            // The string did not change, only the selection is placed again.
+            requestLayout(string.getSize(), string.getSize());
+            invalidate();
         }
     }
 
@@ -515,11 +894,12 @@ namespace jui
         if(selection_color != p_color)
         {
             selection_color = p_color;
+            invalidate();
 
             if (!geometry_need_update)
             {
-                for (int i = 0; i < selection_vertices.getVertexCount(); i++)
-                    selection_vertices[i].color = selection_color;
+                for (int i = 0; i < geometry.selection_vertices.getVertexCount(); i++)
+                    geometry.selection_vertices[i].color = selection_color;
             }
         }
     }
@@ -533,93 +913,174 @@ namespace jui
     {
         ensureGeometryUpdate();
 
-        int current_index = 0;
-
-        for (int i = 0; i < text_info.size(); i++)
+        const std::vector<sf::Vector2f>& positions = geometry.character_positions;
+        if(p_index >= 0 && p_index < positions.size())
         {
-            for (int j = 0; j < text_info[i].size(); j++)
-            {
-                if(current_index == p_index) 
-                {
-                    return text_transform.transformPoint(sf::Vector2f(text_info[i][j].position.x, text_info[i][j].position.y - character_size));
-                }
-                current_index++;
-            }
+            return text_transform.transformPoint(sf::Vector2f(positions[p_index].x, positions[p_index].y - character_size));
         }
 
         // The text is empty or index is out of bounds, just return the position of the first/last character.
-        if(current_index == 0 || p_index < 0) return text_transform.transformPoint(sf::Vector2f(start_of_string.x, start_of_string.y - character_size));
-        return text_transform.transformPoint(sf::Vector2f(end_of_string.x, end_of_string.y - character_size));
+        if(positions.size() == 0 || p_index < 0) return text_transform.transformPoint(sf::Vector2f(geometry.start_of_string.x, geometry.start_of_string.y - character_size));
+        return text_transform.transformPoint(sf::Vector2f(geometry.end_of_string.x, geometry.end_of_string.y - character_size));
     }
 
     int TextField::findIndex(const sf::Vector2f& p_position) const
     {
         ensureGeometryUpdate();
 
-        float smallest_distance = 0.f;
-        int smallest_distance_index = 0; 
-        int current_index = 0; 
-        bool first = true;
+        const std::vector<sf::Vector2f>& positions = geometry.character_positions;
+        const std::vector<int>& line_starts = geometry.line_starts;
+        // The text is empty.
+        if(positions.size() == 0) return 0;
 
-        for (int i = 0; i < text_info.size(); i++)
-        {
-            for (int j = 0; j < text_info[i].size(); j++)
-            {
-                sf::Vector2f distance_vector = text_transform.transformPoint(text_info[i][j].position) - p_position;
-                float square_distance = distance_vector.x * distance_vector.x + distance_vector.y * distance_vector.y; // No need to pull the square root. 
+        sf::Vector2f position = p_position - text_transform.transformPoint(sf::Vector2f());
 
-                if(first)
-                {
-                    smallest_distance = square_distance;
-                    smallest_distance_index = current_index;
-                    first = false;
-                }
+        // The lines follow each other from top to bottom, so the characters are sorted by their height. Take the line below or above the position, whichever is closer.
+        int index = std::lower_bound(positions.begin(), positions.end(), position.y, [](const sf::Vector2f& p_character, float p_y) { return p_character.y < p_y; }) - positions.begin();
+        if(index == positions.size() || (index > 0 && position.y - positions[index - 1].y < positions[index].y - position.y)) index--;
 
-                if(square_distance < smallest_distance)
-                {
-                    smallest_distance = square_distance;
-                    smallest_distance_index = current_index;
-                }
-                current_index++;
-            }
-        }
-        // The text is empty.
-        if(current_index == 0) return 0;
+        // Within the line the characters are sorted from left to right, so only the characters left and right of the position need to be compared.
+        std::vector<int>::const_iterator line_end = std::upper_bound(line_starts.begin(), line_starts.end(), index);
+        int first_index = *(line_end - 1);
+        int end_index = *line_end;
+        index = std::lower_bound(positions.begin() + first_index, positions.begin() + end_index, position.x, [](const sf::Vector2f& p_character, float p_x) { return p_character.x < p_x; }) - positions.begin();
+        if(index == end_index || (index > first_index && position.x - positions[index - 1].x < positions[index].x - position.x)) index--;
+
+        sf::Vector2f distance_vector = positions[index] - position;
+        float smallest_distance = distance_vector.x * distance_vector.x + distance_vector.y * distance_vector.y; // No need to pull the square root. 
 
         // Since the cursor should appear behind the last character and not in front, we need to also check that position.
-        sf::Vector2f distance_vector = text_transform.transformPoint(end_of_string) - p_position;
+        distance_vector = geometry.end_of_string - position;
         float square_distance = distance_vector.x * distance_vector.x + distance_vector.y * distance_vector.y;
         if(square_distance < smallest_distance)
         {
-            smallest_distance = square_distance;
-            smallest_distance_index = current_index;
+            return positions.size();
         }
 
-        return smallest_distance_index;
+        return index;
+    }
+
+    void TextField::requestLayout()
+    {
+        whole_text_changed = true;
+        geometry_need_update = true;
+        canvas.requestLayout(this);
+    }
+
+    void TextField::requestLayout(int p_unchanged_prefix, int p_unchanged_suffix)
+    {
+        // After several edits only the characters none of them changed are left.
+        unchanged_prefix = std::min(unchanged_prefix, p_unchanged_prefix);
+        unchanged_suffix = std::min(unchanged_suffix, p_unchanged_suffix);
+        geometry_need_update = true;
+        canvas.requestLayout(this);
     }
 
     void TextField::ensureGeometryUpdate() const
     {
         // Ensure an update is needed due to a change of the text.
         if(!geometry_need_update) return;
+
+        // Usually the canvas lays out changed text fields in parallel before drawing. Text fields needed earlier, or only a few of them, are laid out right here.
+        Layout layout;
+        prepareLayout(layout);
+        computeLayout(layout, geometry);
+        applyLayout(geometry);
+    }
+
+    void TextField::prepareLayout(Layout& p_layout) const
+    {
+        p_layout.string = string;
+        p_layout.character_size = character_size;
+        p_layout.line_spacing = font.getLineSpacing(character_size) * line_spacing_factor;
+        p_layout.paragraph_spacing = font.getLineSpacing(character_size) * paragraph_spacing_factor;
+        p_layout.size = getSize();
+        p_layout.text_color = text_color;
+        p_layout.selection_color = selection_color;
+        p_layout.horizontal_alignment = horizontal_alignment;
+        p_layout.vertical_alignment = vertical_alignment;
+        p_layout.overflow_type = overflow_type;
+        p_layout.wrapping = wrapping;
+        p_layout.start_selection = start_selection;
+        p_layout.end_selection = end_selection;
+        p_layout.whole_text = whole_text_changed;
+        p_layout.unchanged_prefix = unchanged_prefix;
+        p_layout.unchanged_suffix = unchanged_suffix;
+
+        // Only glyphs missing from the table of the font are asked for. After an edit only the glyphs of the changed characters can be missing.
+        const GlyphTable& glyphs = Fonts::getGlyphTable(font, character_size);
+        p_layout.glyphs = &glyphs;
+        p_layout.font = &font;
+        int first_index = 0;
+        int end_index = string.getSize();
+        if(!whole_text_changed)
+        {
+            first_index = std::min(unchanged_prefix, end_index);
+            end_index = std::max(first_index, end_index - unchanged_suffix);
+        }
+        // Line breaks are drawn as spaces, and dotted overflow adds dots.
+        if(glyphs.find(' ') == nullptr) Fonts::getGlyph(font, ' ', character_size);
+        if(glyphs.find('.') == nullptr) Fonts::getGlyph(font, '.', character_size);
+        for (int i = first_index; i < end_index; i++)
+        {
+            if(glyphs.find(string[i]) == nullptr) Fonts::getGlyph(font, string[i], character_size);
+        }
+    }
+
+    void TextField::applyLayout(Geometry& p_geometry) const
+    {
         // Mark as updated.
+        if(&p_geometry != &geometry) std::swap(geometry, p_geometry);
         geometry_need_update = false;
+        whole_text_changed = false;
+        unchanged_prefix = std::numeric_limits<int>::max();
+        unchanged_suffix = std::numeric_limits<int>::max();
+        if(pending_layout_position != -1) canvas.cancelLayout(const_cast<TextField*>(this));
+        profileGeometryRebuild();
+        // The text can overflow the text field.
+        setOverflowBounds(text_transform.transformRect(geometry.quad_bounds));
+    }
 
-        // Update geometry.
-        applyStringGeometry(string);
+    const sf::Glyph& TextField::Layout::getGlyph(sf::Uint32 p_char) const
+    {
+        const sf::Glyph* glyph = glyphs->find(p_char);
+        // prepareLayout() loads all glyphs the layout needs, but a glyph missing anyway is asked for rather than read from nowhere.
+        if(glyph == nullptr) return Fonts::getGlyph(*font, p_char, character_size);
+        return *glyph;
+    }
 
-        // Update overflow.
-        if(overflow_type != Overflow)
+    void TextField::computeLayout(const Layout& p_layout, Geometry& p_geometry)
+    {
+        // After an edit of the string only the lines around it are laid out again.
+        if(p_layout.whole_text || !applyStringEdit(p_layout, p_geometry))
         {
-            applyStringGeometry(applyOverflowType());
-        }
+            // Update geometry.
+            applyStringGeometry(p_layout, p_layout.string, p_geometry);
 
-        // Change alignment.
-        applyHorizontalAlignment();
-        applyVerticalAlignment();
+            // Update overflow.
+            if(p_layout.overflow_type != Overflow)
+            {
+                applyStringGeometry(p_layout, applyOverflowType(p_layout, p_geometry), p_geometry);
+            }
+
+            // Change alignment.
+            applyHorizontalAlignment(p_layout, p_geometry, 0, p_geometry.line_info.size());
+            applyVerticalAlignment(p_layout, p_geometry);
+        }
 
         // Update selection.
-        applySelection();
+        applySelection(p_layout, p_geometry);
+
+        p_geometry.quad_bounds = p_geometry.vertices.getBounds();
+        if(p_geometry.selection_vertices.getVertexCount() > 0)
+        {
+            sf::FloatRect selection_bounds = p_geometry.selection_vertices.getBounds();
+            float left = std::min(p_geometry.quad_bounds.left, selection_bounds.left);
+            float top = std::min(p_geometry.quad_bounds.top, selection_bounds.top);
+            float right = std::max(p_geometry.quad_bounds.left + p_geometry.quad_bounds.width, selection_bounds.left + selection_bounds.width);
+            float bottom = std::max(p_geometry.quad_bounds.top + p_geometry.quad_bounds.height, selection_bounds.top + selection_bounds.height);
+            p_geometry.quad_bounds = sf::FloatRect(left, top, right - left, bottom - top);
+        }
     }
 
     void TextField::draw() const 
@@ -628,18 +1089,16 @@ namespace jui
 
         ensureGeometryUpdate();
 
-        window.setView(getMask() == nullptr ? canvas.getView() : getMask()->getView()); // Use parent's view if available.
-
-        sf::RenderStates states;
-        states.transform *= text_transform;
-        states.texture = &font.getTexture(character_size);
-        window.draw(vertices, states);
+        // The text is only clipped by the mask, so it can overflow the text field. Use parent's bounds if available.
+        sf::FloatRect clip = getMask() == nullptr ? canvas.getBounds() : getMask()->getClippedBounds();
+        sf::Vector2f offset = text_transform.transformPoint(sf::Vector2f());
 
-        states.texture = nullptr;
-        window.draw(selection_vertices, states);
+        QuadBatch& batch = canvas.getBatch();
+        batch.addQuads(geometry.vertices, offset, &font.getTexture(character_size), clip, true);
+        batch.addQuads(geometry.selection_vertices, offset, nullptr, clip);
     }
 
-    void TextField::addGlyphQuad(sf::VertexArray& p_vertices, const sf::Vector2f& p_position, const sf::Color& p_color, const sf::Glyph& p_glyph) const
+    void TextField::addGlyphQuad(sf::VertexArray& p_vertices, const sf::Vector2f& p_position, const sf::Color& p_color, const sf::Glyph& p_glyph)
     {
         // Bounds of each quad.
         float left = p_glyph.bounds.left;
@@ -653,195 +1112,341 @@ namespace jui
         float u2 = p_glyph.textureRect.left + p_glyph.textureRect.width;
         float v2 = p_glyph.textureRect.top  + p_glyph.textureRect.height;
 
-        // Every quad is made up from two triangles, therefore 6 vertices are added to the passed vertex array.
-        p_vertices.append(sf::Vertex(sf::Vector2f(p_position.x + left, p_position.y + bottom), p_color, sf::Vector2f(u1, v2)));
-        p_vertices.append(sf::Vertex(sf::Vector2f(p_position.x + left, p_position.y + top), p_color,    sf::Vector2f(u1, v1)));
-        p_vertices.append(sf::Vertex(sf::Vector2f(p_position.x + right, p_position.y + top), p_color,   sf::Vector2f(u2, v1)));
-        p_vertices.append(sf::Vertex(sf::Vector2f(p_position.x + left, p_position.y + bottom), p_color, sf::Vector2f(u1, v2)));
-        p_vertices.append(sf::Vertex(sf::Vector2f(p_position.x + right, p_position.y + top), p_color,   sf::Vector2f(u2, v1)));
-        p_vertices.append(sf::Vertex(sf::Vector2f(p_position.x + right, p_position.y + bottom), p_color,sf::Vector2f(u2, v2)));
+        // Every quad is made up from two triangles, therefore 6 vertices are added to the passed vertex array. They are written in place, the array grows like a vector.
+        std::size_t count = p_vertices.getVertexCount();
+        p_vertices.resize(count + 6);
+        sf::Vertex* quad = &p_vertices[count];
+        quad[0] = sf::Vertex(sf::Vector2f(p_position.x + left, p_position.y + bottom), p_color, sf::Vector2f(u1, v2));
+        quad[1] = sf::Vertex(sf::Vector2f(p_position.x + left, p_position.y + top), p_color,    sf::Vector2f(u1, v1));
+        quad[2] = sf::Vertex(sf::Vector2f(p_position.x + right, p_position.y + top), p_color,   sf::Vector2f(u2, v1));
+        quad[3] = quad[0];
+        quad[4] = quad[2];
+        quad[5] = sf::Vertex(sf::Vector2f(p_position.x + right, p_position.y + bottom), p_color,sf::Vector2f(u2, v2));
     }
 
-    void TextField::applyHorizontalAlignment() const
+    void TextField::applyHorizontalAlignment(const Layout& p_layout, Geometry& p_geometry, int p_first_line, int p_end_line)
     {
-        if(horizontal_alignment == Left) return;
-        for (int i = 0; i < text_info.size(); i++)
+        if(p_layout.horizontal_alignment == Left) return;
+        for (int i = p_first_line; i < p_end_line; i++)
         {
+            int first_index = p_geometry.line_starts[i];
+            int end_index = p_geometry.line_starts[i + 1];
             // Skip empty lines.
-            if(text_info[i].size() == 0) continue;
+            if(first_index == end_index) continue;
 
-            sf::Vector2f start_position = vertices[text_info[i][0].start_vertex].position;
-            sf::Vector2f end_position = vertices[text_info[i][text_info[i].size() - 1].end_vertex].position;
+            sf::Vector2f start_position = p_geometry.vertices[6 * first_index].position;
+            sf::Vector2f end_position = p_geometry.vertices[6 * end_index - 1].position;
             float distanceToMove = 0.f;
-            if(horizontal_alignment == Right)
+            if(p_layout.horizontal_alignment == Right)
             {
-                distanceToMove = getSize().x - end_position.x;
+                distanceToMove = p_layout.size.x - end_position.x;
             }
-            else if(horizontal_alignment == Centered)
+            else if(p_layout.horizontal_alignment == Centered)
             {
-                distanceToMove = (getSize().x/2.f) - (end_position.x - start_position.x)/2.f;
+                distanceToMove = (p_layout.size.x/2.f) - (end_position.x - start_position.x)/2.f;
             }
 
             // Update actual vertices.
-            for (int j = text_info[i][0].start_vertex; j < text_info[i][text_info[i].size() - 1].end_vertex + 1; j++)
+            for (int j = 6 * first_index; j < 6 * end_index; j++)
             {
-                vertices[j].position.x += (int)distanceToMove;
+                p_geometry.vertices[j].position.x += (int)distanceToMove;
             }
 
-            // Update text_info array.
-            for (int j = 0; j < text_info[i].size(); j++)
+            // Update character positions.
+            for (int j = first_index; j < end_index; j++)
             {
-                text_info[i][j].position.x += (int)distanceToMove;
+                p_geometry.character_positions[j].x += (int)distanceToMove;
             }
-            start_of_string.x += (int)distanceToMove;
-            end_of_string.x += (int)distanceToMove;
+            // The string ends on the last line.
+            if(i == p_geometry.line_info.size() - 1) p_geometry.end_of_string.x += (int)distanceToMove;
         }
     }
 
-    void TextField::applyVerticalAlignment() const
+    void TextField::applyVerticalAlignment(const Layout& p_layout, Geometry& p_geometry)
     {
-        float distanceToMove = 0.f;
-
-        if(vertical_alignment == Top) return;
-        else if(vertical_alignment == Middle)
-            distanceToMove = (getSize().y/2.f) - (text_bounds.height/2.f);
-        else if (vertical_alignment == Bottom)
-            distanceToMove = getSize().y - text_bounds.height;
-        
-        // Update actual vertices.
-        for (int i = 0; i < vertices.getVertexCount(); i++)
+        // The bounds of the text before it was aligned.
+        p_geometry.text_bounds = sf::FloatRect();
+        for (const LineInfo& line : p_geometry.line_info)
         {
-            vertices[i].position.y += (int)distanceToMove;
+            p_geometry.text_bounds.width = std::max(p_geometry.text_bounds.width, line.right);
+            p_geometry.text_bounds.height = std::max(p_geometry.text_bounds.height, line.bottom - p_geometry.vertical_offset);
         }
-        // Update text_info array.
-        for (int i = 0; i < text_info.size(); i++)
+
+        float distanceToMove = 0.f;
+        if(p_layout.vertical_alignment == Middle)
+            distanceToMove = (p_layout.size.y/2.f) - (p_geometry.text_bounds.height/2.f);
+        else if (p_layout.vertical_alignment == Bottom)
+            distanceToMove = p_layout.size.y - p_geometry.text_bounds.height;
+
+        // Lines that were not laid out again after an edit are already moved, so only the difference is applied.
+        float offset = (int)distanceToMove - p_geometry.vertical_offset;
+        if(offset != 0.f)
         {
-            for (int j = 0; j < text_info[i].size(); j++)
+            // Update actual vertices.
+            for (int i = 0; i < p_geometry.vertices.getVertexCount(); i++)
+            {
+                p_geometry.vertices[i].position.y += offset;
+            }
+            // Update character positions and lines.
+            for (int i = 0; i < p_geometry.character_positions.size(); i++)
+            {
+                p_geometry.character_positions[i].y += offset;
+            }
+            for (int i = 0; i < p_geometry.line_info.size(); i++)
             {
-                text_info[i][j].position.y += (int)distanceToMove;
+                p_geometry.line_info[i].bottom += offset;
             }
+            p_geometry.end_of_string.y += offset;
+            p_geometry.vertical_offset += offset;
+        }
+
+        // The string starts with the first line, or in an empty text at the height of the cursor.
+        if(p_geometry.line_starts[1] > 0)
+        {
+            p_geometry.start_of_string = p_geometry.character_positions[0];
+        }
+        else
+        {
+            p_geometry.start_of_string = sf::Vector2f(0.f, p_layout.character_size + p_geometry.vertical_offset);
+            if(p_geometry.vertices.getVertexCount() == 0 && p_layout.vertical_alignment != Top) p_geometry.start_of_string.y -= p_layout.character_size/2.f;
         }
-        
-        start_of_string.y += vertices.getVertexCount() == 0 ? (int)distanceToMove - character_size/2.f : (int)distanceToMove;
-        end_of_string.y += (int)distanceToMove;
     }
 
-    sf::String TextField::applyOverflowType() const
+    sf::String TextField::applyOverflowType(const Layout& p_layout, const Geometry& p_geometry)
     {
-        sf::String modified_string = string;
-        int current_index = 0;
-        for (int i = 0; i < text_info.size(); i++)
+        sf::String modified_string = p_layout.string;
+        for (int i = 0; i < p_geometry.character_positions.size(); i++)
         {
-            for (int j = 0; j < text_info[i].size(); j++)
+            if(p_geometry.vertices[6 * i + 5].position.x > p_layout.size.x || p_geometry.vertices[6 * i].position.y >= p_layout.size.y)
             {
-                if(vertices[text_info[i][j].end_vertex].position.x > getSize().x || vertices[text_info[i][j].start_vertex].position.y >= getSize().y)
+                if(p_layout.overflow_type == Truncate)
                 {
-                    if(overflow_type == Truncate)
-                    {
-                        return modified_string.substring(0, current_index);
-                    }
-                    else if (overflow_type == Dotted)
-                    {
-                        return modified_string.substring(0, current_index - 4 >= 0 ? current_index - 4 : 0) + "...";
-                    }
+                    return modified_string.substring(0, i);
+                }
+                else if (p_layout.overflow_type == Dotted)
+                {
+                    return modified_string.substring(0, i - 4 >= 0 ? i - 4 : 0) + "...";
                 }
-                current_index++;
             }
         }
         return modified_string;
     }
 
-    void TextField::applySelection() const
+    void TextField::applySelection(const Layout& p_layout, Geometry& p_geometry)
     {
-        selection_vertices.clear();
-        int current_index = 0;
+        p_geometry.selection_vertices.clear();
+        if(p_layout.start_selection >= p_layout.end_selection) return;
+        const std::vector<sf::Vector2f>& positions = p_geometry.character_positions;
+        const std::vector<int>& line_starts = p_geometry.line_starts;
 
         // Find highest character position.
         float highest_character_position = 0.f;
-        for (int i = 0; i < text_info.size(); i++)
+        for (int i = 0; i < positions.size(); i++)
         {
-            for (int j = 0; j < text_info[i].size(); j++)
-            {
-                highest_character_position = std::max(highest_character_position, vertices[text_info[i][j].start_vertex].position.y);
-            }
+            highest_character_position = std::max(highest_character_position, p_geometry.vertices[6 * i].position.y);
         }
 
         // Place vertices for selection.
-        for (int i = 0; i < text_info.size(); i++)
+        int start_index = std::max(p_layout.start_selection, 0);
+        int end_index = std::min(p_layout.end_selection, (int)positions.size());
+        if(start_index >= end_index) return;
+        int line = std::upper_bound(line_starts.begin(), line_starts.end(), start_index) - line_starts.begin() - 1;
+        for (int i = start_index; i < end_index; i++)
         {
-            for (int j = 0; j < text_info[i].size(); j++)
+            while(line_starts[line + 1] <= i) line++;
+
+            sf::Vector2f position = sf::Vector2f(p_geometry.vertices[6 * i].position.x, highest_character_position);
+            sf::Vector2f size = sf::Vector2f(0.f, highest_character_position - (positions[i].y - p_layout.character_size));
+            if(i + 1 < line_starts[line + 1])
             {
-                if(current_index >= start_selection && current_index < end_selection)
-                {
-                    sf::Vector2f position = sf::Vector2f(vertices[text_info[i][j].start_vertex].position.x, highest_character_position);
-                    sf::Vector2f size = sf::Vector2f(0.f, highest_character_position - (text_info[i][j].position.y - character_size));
-                    if(j + 1 < text_info[i].size())
-                    {
-                        size.x = vertices[text_info[i][j + 1].start_vertex].position.x - vertices[text_info[i][j].start_vertex].position.x;
-                    }
-                    else
-                    {
-                        size.x = end_of_string.x - vertices[text_info[i][j].start_vertex].position.x;
-                    }
+                size.x = p_geometry.vertices[6 * (i + 1)].position.x - p_geometry.vertices[6 * i].position.x;
+            }
+            else
+            {
+                size.x = p_geometry.end_of_string.x - p_geometry.vertices[6 * i].position.x;
+            }
 
-                    selection_vertices.append(sf::Vertex(sf::Vector2f(position.x, position.y), selection_color));
-                    selection_vertices.append(sf::Vertex(sf::Vector2f(position.x + size.x, position.y), selection_color));
-                    selection_vertices.append(sf::Vertex(sf::Vector2f(position.x + size.x, position.y - size.y), selection_color));
-                    selection_vertices.append(sf::Vertex(sf::Vector2f(position.x, position.y), selection_color));
-                    selection_vertices.append(sf::Vertex(sf::Vector2f(position.x + size.x, position.y - size.y), selection_color));
-                    selection_vertices.append(sf::Vertex(sf::Vector2f(position.x, position.y - size.y), selection_color));
-                }
+            p_geometry.selection_vertices.append(sf::Vertex(sf::Vector2f(position.x, position.y), p_layout.selection_color));
+            p_geometry.selection_vertices.append(sf::Vertex(sf::Vector2f(position.x + size.x, position.y), p_layout.selection_color));
+            p_geometry.selection_vertices.append(sf::Vertex(sf::Vector2f(position.x + size.x, position.y - size.y), p_layout.selection_color));
+            p_geometry.selection_vertices.append(sf::Vertex(sf::Vector2f(position.x, position.y), p_layout.selection_color));
+            p_geometry.selection_vertices.append(sf::Vertex(sf::Vector2f(position.x + size.x, position.y - size.y), p_layout.selection_color));
+            p_geometry.selection_vertices.append(sf::Vertex(sf::Vector2f(position.x, position.y - size.y), p_layout.selection_color));
+        }
+    }
+
+    void TextField::applyStringGeometry(const Layout& p_layout, const sf::String& p_string, Geometry& p_geometry)
+    {
+        // Reset and compute important values. Clearing keeps the memory of the arrays for the next layout.
+        p_geometry.vertices.clear();
+        p_geometry.character_positions.clear();
+        p_geometry.line_starts.clear();
+        p_geometry.line_starts.push_back(0);
+        p_geometry.line_info.clear();
+        p_geometry.vertical_offset = 0.f;
+
+        float y = p_layout.character_size;
+        applyLines(p_layout, p_string, 0, p_string.getSize(), y, p_geometry);
+    }
+
+    bool TextField::applyStringEdit(const Layout& p_layout, Geometry& p_geometry)
+    {
+        // An overflow type cuts the string off, so the geometry does not match the characters anymore.
+        if(p_layout.overflow_type != Overflow || p_geometry.line_info.size() == 0) return false;
+
+        const sf::String& string = p_layout.string;
+        int size = string.getSize();
+        int old_size = p_geometry.vertices.getVertexCount() / 6;
+        int shift = size - old_size;
+        int prefix = std::min(p_layout.unchanged_prefix, std::min(size, old_size));
+        int suffix = std::min(p_layout.unchanged_suffix, std::min(size, old_size) - prefix);
+        if(prefix == size && shift == 0) return true;
+
+        int line_count = p_geometry.line_info.size();
+        std::vector<int>& line_starts = p_geometry.line_starts;
+        std::vector<sf::Vector2f>& positions = p_geometry.character_positions;
 
-                current_index++;
+        // A space breaks the line if the word after it does not fit, so the last space before the edit can break differently now.
+        int first_changed = prefix;
+        for (int i = prefix - 1; i >= 0 && p_layout.wrapping; i--)
+        {
+            if(string[i] == ' ')
+            {
+                first_changed = i;
+                break;
+            }
+        }
+        // Start at the line of the first changed character. A wrapped line depends on the end of the line before, so start before it.
+        int first_line = std::upper_bound(line_starts.begin(), line_starts.begin() + line_count, first_changed) - line_starts.begin() - 1;
+        while(first_line > 0 && (line_starts[first_line + 1] == line_starts[first_line] || p_geometry.line_info[first_line].wrapped)) first_line--;
+        int first_index = line_starts[first_line];
+        float y = first_line == 0 ? p_layout.character_size + p_geometry.vertical_offset : positions[first_index].y;
+
+        // Lay out the lines until one starts behind the edit at the same character as before. All lines after it stay the same and are only moved.
+        Geometry lines;
+        lines.line_starts.push_back(0);
+        int index = first_index;
+        int kept_line = line_count;
+        while(true)
+        {
+            index = applyLines(p_layout, string, index, size - suffix, y, lines);
+            if(index == size) break;
+
+            int line = std::lower_bound(line_starts.begin() + first_line, line_starts.begin() + line_count, index - shift) - line_starts.begin();
+            if(line < line_count && line_starts[line] == index - shift && line_starts[line + 1] > line_starts[line] && !p_geometry.line_info[line].wrapped)
+            {
+                kept_line = line;
+                break;
+            }
+        }
+        int kept_index = kept_line < line_count ? line_starts[kept_line] : old_size;
+        float offset = kept_line < line_count ? y - positions[kept_index].y : 0.f;
+
+        // Move the vertices of the kept lines behind the new ones.
+        int new_vertex_count = lines.vertices.getVertexCount();
+        int kept_vertex_count = 6 * (old_size - kept_index);
+        int source = 6 * kept_index;
+        int destination = 6 * first_index + new_vertex_count;
+        if(destination > source)
+        {
+            p_geometry.vertices.resize(destination + kept_vertex_count);
+            std::copy_backward(&p_geometry.vertices[0] + source, &p_geometry.vertices[0] + source + kept_vertex_count, &p_geometry.vertices[0] + destination + kept_vertex_count);
+        }
+        else if(destination < source)
+        {
+            std::copy(&p_geometry.vertices[0] + source, &p_geometry.vertices[0] + source + kept_vertex_count, &p_geometry.vertices[0] + destination);
+            p_geometry.vertices.resize(destination + kept_vertex_count);
+        }
+        for (int i = 0; i < new_vertex_count; i++)
+        {
+            p_geometry.vertices[6 * first_index + i] = lines.vertices[i];
+        }
+        if(offset != 0.f)
+        {
+            for (int i = destination; i < destination + kept_vertex_count; i++)
+            {
+                p_geometry.vertices[i].position.y += offset;
             }
         }
+
+        // Replace the characters of the lines laid out again. The kept lines are moved, and start later by the change of the length.
+        for (int i = kept_index; i < old_size; i++)
+        {
+            positions[i].y += offset;
+        }
+        positions.erase(positions.begin() + first_index, positions.begin() + kept_index);
+        positions.insert(positions.begin() + first_index, lines.character_positions.begin(), lines.character_positions.end());
+        for (int i = kept_line; i <= line_count; i++)
+        {
+            line_starts[i] += shift;
+        }
+        line_starts.erase(line_starts.begin() + first_line, line_starts.begin() + kept_line);
+        line_starts.insert(line_starts.begin() + first_line, lines.line_starts.begin(), lines.line_starts.end() - 1);
+        for (int i = first_line; i < first_line + lines.line_info.size(); i++)
+        {
+            line_starts[i] += first_index;
+        }
+        for (int i = kept_line; i < line_count; i++)
+        {
+            p_geometry.line_info[i].bottom += offset;
+        }
+        p_geometry.line_info.erase(p_geometry.line_info.begin() + first_line, p_geometry.line_info.begin() + kept_line);
+        p_geometry.line_info.insert(p_geometry.line_info.begin() + first_line, lines.line_info.begin(), lines.line_info.end());
+        if(kept_line < line_count) p_geometry.end_of_string.y += offset;
+        else p_geometry.end_of_string = lines.end_of_string;
+
+        // Only the new lines need to be aligned horizontally, the vertical alignment can change with the height of the text.
+        applyHorizontalAlignment(p_layout, p_geometry, first_line, first_line + lines.line_info.size());
+        applyVerticalAlignment(p_layout, p_geometry);
+        return true;
     }
 
-    void TextField::applyStringGeometry(const sf::String& p_string) const
+    int TextField::applyLines(const Layout& p_layout, const sf::String& p_string, int p_index, int p_stop_index, float& p_y, Geometry& p_geometry)
     {
-        // Reset and compute important values.
-        text_bounds = sf::FloatRect();
-        vertices.clear();
-        text_info.clear();
-        std::vector<CharacterInfo> current_line;
+        LineInfo current_line_info;
 
-        float line_spacing = font.getLineSpacing(character_size) * line_spacing_factor;
-        float paragraph_spacing = font.getLineSpacing(character_size) * paragraph_spacing_factor;
+        float line_spacing = p_layout.line_spacing;
+        float paragraph_spacing = p_layout.paragraph_spacing;
         float x = 0.f;
-        float y = character_size;
-        start_of_string = sf::Vector2f(x, y);
+        float y = p_y;
+
+        // A space measures the word after it. Its glyphs are kept until they are placed, so every glyph is only looked up once and the layout takes linear time.
+        std::vector<const sf::Glyph*> word_glyphs;
+        int word_start = 0;
 
         // Loop through each character in the string and place its vertices.
-        for (int i = 0; i < p_string.getSize(); i++)
+        for (int i = p_index; i < p_string.getSize(); i++)
         {
             // Store character data.
             sf::Uint32 current_char = p_string[i];
-            const sf::Glyph& current_glyph = font.getGlyph(current_char, character_size, false);
+            const sf::Glyph& current_glyph = i - word_start < word_glyphs.size() ? *word_glyphs[i - word_start] : p_layout.getGlyph(current_char);
+            bool line_ended = false;
 
             // Place vertices.
             if(current_char == '\n')
             {
-                current_line.push_back( { sf::Vector2f(x, y),  (int)vertices.getVertexCount(), (int)vertices.getVertexCount() + 5 });
-                addGlyphQuad(vertices, sf::Vector2f(x, y), text_color, font.getGlyph(' ', character_size, false));
+                p_geometry.character_positions.push_back(sf::Vector2f(x, y));
+                addGlyphQuad(p_geometry.vertices, sf::Vector2f(x, y), p_layout.text_color, p_layout.getGlyph(' '));
 
                 x = 0.f;
                 y += paragraph_spacing;
-                text_info.push_back(current_line);
-                current_line.clear();
+                line_ended = true;
             }
-            else if(x + current_glyph.advance > getSize().x && wrapping) // Sometimes there will be no space on a line that is too long, so just break the line if it gets too long.
+            else if(x + current_glyph.advance > p_layout.size.x && p_layout.wrapping) // Sometimes there will be no space on a line that is too long, so just break the line if it gets too long.
             {
                 x = 0.f;
                 y += line_spacing;
 
-                text_info.push_back(current_line);
-                current_line.clear();
+                p_geometry.line_starts.push_back(p_geometry.character_positions.size());
+                p_geometry.line_info.push_back(current_line_info);
+                current_line_info = LineInfo();
+                current_line_info.wrapped = true;
 
-                current_line.push_back( { sf::Vector2f(x, y), (int)vertices.getVertexCount(), (int)vertices.getVertexCount() + 5 });
-                addGlyphQuad(vertices, sf::Vector2f(x, y), text_color, current_glyph);
+                p_geometry.character_positions.push_back(sf::Vector2f(x, y));
+                addGlyphQuad(p_geometry.vertices, sf::Vector2f(x, y), p_layout.text_color, current_glyph);
                 x += current_glyph.advance;
             }
-            else if(current_char == ' ' && wrapping) // If there is a space search the next space coming up in the string, and calculate if the distance between both string positions still fits on the current line.
+            else if(current_char == ' ' && p_layout.wrapping) // If there is a space search the next space coming up in the string, and calculate if the distance between both string positions still fits on the current line.
             {
                 int result_index = i;
                 bool searching = true;
@@ -858,38 +1463,57 @@ namespace jui
                         searching = false;
                     }
                 }
-                float distanceToBounds = getSize().x - (x + current_glyph.advance);
+                float distanceToBounds = p_layout.size.x - (x + current_glyph.advance);
                 float distanceOfChars = 0.f;
+                word_glyphs.clear();
+                word_start = i;
                 for (int j = i; j < result_index; j++)
                 {
-                    distanceOfChars += font.getGlyph(p_string[j], character_size, false).advance;
+                    word_glyphs.push_back(&p_layout.getGlyph(p_string[j]));
+                    distanceOfChars += word_glyphs.back()->advance;
                 }
 
-                current_line.push_back( { sf::Vector2f(x, y), (int)vertices.getVertexCount(), (int)vertices.getVertexCount() + 5 });
-                addGlyphQuad(vertices, sf::Vector2f(x, y), text_color, current_glyph);
+                p_geometry.character_positions.push_back(sf::Vector2f(x, y));
+                addGlyphQuad(p_geometry.vertices, sf::Vector2f(x, y), p_layout.text_color, current_glyph);
                 x += current_glyph.advance;
 
                 if(distanceOfChars > distanceToBounds) // We need to break the line.
                 {
                     x = 0.f;
                     y += line_spacing;
-                    text_info.push_back(current_line);
-                    current_line.clear();
+                    line_ended = true;
                 }
             }
             else
             {
-                current_line.push_back( { sf::Vector2f(x, y), (int)vertices.getVertexCount(), (int)vertices.getVertexCount() + 5 });
-                addGlyphQuad(vertices, sf::Vector2f(x, y), text_color, current_glyph);
+                p_geometry.character_positions.push_back(sf::Vector2f(x, y));
+                addGlyphQuad(p_geometry.vertices, sf::Vector2f(x, y), p_layout.text_color, current_glyph);
                 x += current_glyph.advance;
             }
 
-            // Update text_bounds.
-            text_bounds.width = std::max(text_bounds.width, x + current_glyph.bounds.left + current_glyph.bounds.width);
-            text_bounds.height = std::max(text_bounds.height, y + current_glyph.bounds.top + current_glyph.bounds.height);
+            // Update the bounds of the line.
+            current_line_info.right = std::max(current_line_info.right, x + current_glyph.bounds.left + current_glyph.bounds.width);
+            current_line_info.bottom = std::max(current_line_info.bottom, y + current_glyph.bounds.top + current_glyph.bounds.height);
+
+            if(line_ended)
+            {
+                p_geometry.line_starts.push_back(p_geometry.character_positions.size());
+                p_geometry.line_info.push_back(current_line_info);
+                current_line_info = LineInfo();
+
+                // The next line does not depend on the lines before, so the layout can stop here.
+                if(i + 1 >= p_stop_index && i + 1 < p_string.getSize())
+                {
+                    p_y = y;
+                    return i + 1;
+                }
+            }
         }
-        text_info.push_back(current_line);
-        end_of_string = sf::Vector2f(x, y);
+        p_geometry.line_starts.push_back(p_geometry.character_positions.size());
+        p_geometry.line_info.push_back(current_line_info);
+        p_geometry.end_of_string = sf::Vector2f(x, y);
+        p_y = y;
+        return p_string.getSize();
     }
 
     Button::Button(Canvas& p_canvas, sf::Font& p_font)
@@ -906,10 +1530,16 @@ namespace jui
 
         setOutlineColor(sf::Color(170, 170, 170));
         setOutlineThickness(1.f);
+        setEventSubscription(ReleaseEvents);
 
         f_event = [](){};
     }
 
+    const char* Button::getTypeName() const
+    {
+        return "Button";
+    }
+
     void Button::setPosition(const sf::Vector2f& p_position)
     {
         Widget::setPosition(p_position);
@@ -926,7 +1556,7 @@ namespace jui
     {
         if(canvas.getHovered() == this)
         {
-            if(sf::Mouse::isButtonPressed(sf::Mouse::Left))
+            if(canvas.getInput().isMouseButtonPressed(sf::Mouse::Left))
             {
                 setFillColor(pressed_color);
                 
@@ -996,6 +1626,8 @@ namespace jui
 
         move_up_button.setMask(this);
         move_down_button.setMask(this);
+        // The handle is masked too, so hovering it requests an update of the scroll bar.
+        scroll_handle.setMask(this);
         move_up_button.text.setHorizontalAlignment(jui::TextField::Centered);
         move_down_button.text.setHorizontalAlignment(jui::TextField::Centered);
         move_up_button.text.setVerticalAlignment(jui::TextField::Middle);
@@ -1021,6 +1653,14 @@ namespace jui
 
         setScrollState(0.f, 100.f, 200.f);
         refreshIcons();
+
+        // The handle is released wherever the mouse is released.
+        setEventSubscription(NoEvents, PressEvents | ReleaseEvents);
+    }
+
+    const char* ScrollBar::getTypeName() const
+    {
+        return "ScrollBar";
     }
 
     void ScrollBar::setPosition(const sf::Vector2f& p_position)
@@ -1128,9 +1768,12 @@ namespace jui
         // Deselect the handle when the left mouse is released.
         if(p_event.type == sf::Event::MouseButtonPressed)
         {
-            if(p_event.mouseButton.button == sf::Mouse::Left && sf::FloatRect(scroll_handle.getPosition(), scroll_handle.getSize()).contains(getMousePosition(window, &view)))
+            if(p_event.mouseButton.button == sf::Mouse::Left && sf::FloatRect(scroll_handle.getPosition(), scroll_handle.getSize()).contains(canvas.getMousePosition()))
             {
                 handle_selected = true;
+                last_mouse_position = canvas.getMousePosition();
+                // The handle follows the mouse every frame while it is dragged.
+                setUpdatedEveryFrame(true);
             }
         }
         if(p_event.type == sf::Event::MouseButtonReleased)
@@ -1138,6 +1781,7 @@ namespace jui
             if(p_event.mouseButton.button == sf::Mouse::Left)
             {
                 handle_selected = false;
+                setUpdatedEveryFrame(false);
             }
         }
     }
@@ -1149,7 +1793,7 @@ namespace jui
             // Move the handle by calculating the difference between the current and last mouse position.
             if(handle_selected)
             {
-                sf::Vector2f difference = getMousePosition(window, &view) - last_mouse_position;
+                sf::Vector2f difference = canvas.getMousePosition() - last_mouse_position;
                 if(orientation == Vertical)
                 {
                     setScrollState(state.scroll_handle_position + (difference.y / getSize().y) * state.scroll_list_length, state.scroll_handle_size, state.scroll_list_length);
@@ -1158,12 +1802,12 @@ namespace jui
                 {
                     setScrollState(state.scroll_handle_position + (difference.x / getSize().x) * state.scroll_list_length, state.scroll_handle_size, state.scroll_list_length);
                 }
-                last_mouse_position = getMousePosition(window, &view);
+                last_mouse_position = canvas.getMousePosition();
             }
         }
 
         // Highlight handle when hovering over it.
-        if(sf::FloatRect(scroll_handle.getPosition(), scroll_handle.getSize()).contains(getMousePosition(window, &view)))
+        if(sf::FloatRect(scroll_handle.getPosition(), scroll_handle.getSize()).contains(canvas.getMousePosition()))
         {
             scroll_handle.setFillColor(hovered_handle_color);
         }
@@ -1175,7 +1819,7 @@ namespace jui
         // Update last mouse position to prevent the handle from making jumps when selecting it.
         if(!handle_selected)
         {
-            last_mouse_position = getMousePosition(window, &view);
+            last_mouse_position = canvas.getMousePosition();
         }
     }
 
@@ -1214,12 +1858,32 @@ namespace jui
 
     }
 
+    LayoutGroup::~LayoutGroup()
+    {
+        if(pending_arrange_position != -1) canvas.cancelArrange(this);
+        clear();
+    }
+
+    const char* LayoutGroup::getTypeName() const
+    {
+        return "LayoutGroup";
+    }
+
     void LayoutGroup::setPosition(const sf::Vector2f& p_position)
     {
+        // Moving the group to its current position happens a lot, e.g. every time a widget is added to a ScrollList, and should not touch the widgets.
         sf::Vector2f difference = p_position - Widget::getPosition();
-        for (int i = 0; i < widget_list.size(); i++)
+        if(difference != sf::Vector2f())
         {
-            widget_list[i]->move(difference);
+            // Moving all widgets by the same offset moves their bounds, but does not change their size.
+            moving_widgets = true;
+            for (int i = 0; i < widget_list.size(); i++)
+            {
+                widget_list[i]->move(difference);
+            }
+            moving_widgets = false;
+            content_bounds.left += difference.x;
+            content_bounds.top += difference.y;
         }
         
         Widget::setPosition(p_position);
@@ -1227,26 +1891,59 @@ namespace jui
 
     sf::Vector2f LayoutGroup::getGroupSize() const
     {
-        if(widget_list.size() < 1) return sf::Vector2f();
-        sf::Vector2f smallest_position = widget_list[0]->getPosition();
-        sf::Vector2f biggest_position = widget_list[0]->getPosition() + widget_list[0]->getSize();
-        for (int i = 0; i < widget_list.size(); i++)
+        if(!bounds_valid)
         {
-            if(widget_list[i]->getPosition().x < smallest_position.x || widget_list[i]->getPosition().y < smallest_position.y)
-            {
-                smallest_position = widget_list[i]->getPosition();
-            }
-            sf::Vector2f current_biggest_position = widget_list[i]->getPosition() + widget_list[i]->getSize();
-            if(current_biggest_position.x > biggest_position.x || current_biggest_position.y > biggest_position.y)
+            content_bounds = sf::FloatRect();
+            if(widget_list.size() > 0)
             {
-                biggest_position = current_biggest_position;
+                sf::Vector2f smallest_position = widget_list[0]->getPosition();
+                sf::Vector2f biggest_position = widget_list[0]->getPosition() + widget_list[0]->getSize();
+                for (int i = 1; i < widget_list.size(); i++)
+                {
+                    sf::Vector2f position = widget_list[i]->getPosition();
+                    sf::Vector2f current_biggest_position = position + widget_list[i]->getSize();
+                    smallest_position = sf::Vector2f(std::min(smallest_position.x, position.x), std::min(smallest_position.y, position.y));
+                    biggest_position = sf::Vector2f(std::max(biggest_position.x, current_biggest_position.x), std::max(biggest_position.y, current_biggest_position.y));
+                }
+                content_bounds = sf::FloatRect(smallest_position, biggest_position - smallest_position);
             }
+            bounds_valid = true;
+        }
+        return sf::Vector2f(content_bounds.width, content_bounds.height);
+    }
+
+    void LayoutGroup::refreshBounds(const sf::FloatRect& p_old_bounds, const sf::FloatRect& p_new_bounds)
+    {
+        if(moving_widgets || !bounds_valid) return;
+
+        // The bounds only get smaller when the widget left one of their edges, and then all widgets have to be checked again.
+        float right = content_bounds.left + content_bounds.width;
+        float bottom = content_bounds.top + content_bounds.height;
+        if((p_old_bounds.left <= content_bounds.left && p_new_bounds.left > content_bounds.left)
+            || (p_old_bounds.top <= content_bounds.top && p_new_bounds.top > content_bounds.top)
+            || (p_old_bounds.left + p_old_bounds.width >= right && p_new_bounds.left + p_new_bounds.width < right)
+            || (p_old_bounds.top + p_old_bounds.height >= bottom && p_new_bounds.top + p_new_bounds.height < bottom))
+        {
+            bounds_valid = false;
+            return;
         }
-        return biggest_position - smallest_position;
+        growBounds(p_new_bounds);
+    }
+
+    void LayoutGroup::growBounds(const sf::FloatRect& p_bounds)
+    {
+        float left = std::min(content_bounds.left, p_bounds.left);
+        float top = std::min(content_bounds.top, p_bounds.top);
+        float right = std::max(content_bounds.left + content_bounds.width, p_bounds.left + p_bounds.width);
+        float bottom = std::max(content_bounds.top + content_bounds.height, p_bounds.top + p_bounds.height);
+        content_bounds = sf::FloatRect(left, top, right - left, bottom - top);
     }
 
     void LayoutGroup::listWidgets(Orientation orientation, float p_spacing)
     {
+        // The bounds are calculated again once all widgets are in place.
+        moving_widgets = true;
+        bounds_valid = false;
         float current_height;
         if(orientation == Vertical)
         {
@@ -1266,6 +1963,296 @@ namespace jui
                 current_height += widget_list[i]->getSize().x + p_spacing;
             }
         }
+        moving_widgets = false;
+    }
+
+    void LayoutGroup::setLayout(LayoutType p_type, Orientation p_orientation, float p_spacing)
+    {
+        if(layout == p_type && orientation == p_orientation && spacing == p_spacing) return;
+
+        // The groups around this group measure it differently now as well.
+        invalidateLayout();
+        layout = p_type;
+        orientation = p_orientation;
+        spacing = p_spacing;
+        invalidateLayout();
+    }
+
+    LayoutType LayoutGroup::getLayout() const
+    {
+        return layout;
+    }
+
+    void LayoutGroup::setColumnCount(int p_count)
+    {
+        if(column_count == std::max(p_count, 1)) return;
+        column_count = std::max(p_count, 1);
+        invalidateLayout();
+    }
+
+    void LayoutGroup::setPadding(float p_padding)
+    {
+        if(padding == p_padding) return;
+        padding = p_padding;
+        invalidateLayout();
+    }
+
+    void LayoutGroup::invalidateLayout()
+    {
+        if(layout == ManualLayout)
+        {
+            Widget::invalidateLayout();
+            return;
+        }
+        if(!measure_valid) return;
+
+        measure_valid = false;
+        arrange_needed = true;
+        if(group == nullptr || group->layout == ManualLayout)
+        {
+            canvas.requestArrange(this);
+        }
+        else
+        {
+            Widget::invalidateLayout();
+        }
+    }
+
+    void LayoutGroup::updateLayout()
+    {
+        if(pending_arrange_position != -1) canvas.cancelArrange(this);
+        if(layout == ManualLayout) return;
+
+        // Groups inside another group with a layout are arranged by it.
+        if(group != nullptr && group->layout != ManualLayout)
+        {
+            group->updateLayout();
+            return;
+        }
+
+        // An anchor stretching the group decides its size instead of its content.
+        sf::Vector2f size = measure();
+        if(getAnchor().width != 0.f) size.x = getSize().x;
+        if(getAnchor().height != 0.f) size.y = getSize().y;
+        if(size != getSize())
+        {
+            Widget::setSize(size);
+            arrange_needed = true;
+        }
+        if(arrange_needed) arrangeWidgets();
+    }
+
+    void LayoutGroup::setSize(const sf::Vector2f& p_size)
+    {
+        bool resized = getSize() != p_size;
+        Widget::setSize(p_size);
+
+        // The outermost group arranges its widgets in its new size before the next frame, the others are arranged by the group around them.
+        if(resized && layout != ManualLayout && (group == nullptr || group->layout == ManualLayout))
+        {
+            arrange_needed = true;
+            canvas.requestArrange(this);
+        }
+    }
+
+    sf::Vector2f LayoutGroup::measure()
+    {
+        if(layout == ManualLayout) return Widget::measure();
+
+        // Only groups whose widgets changed measure them again, the others return the size measured before.
+        if(!measure_valid)
+        {
+            measured_size = measureWidgets();
+            measure_valid = true;
+        }
+        const sf::Vector2f& preferred = getPreferredSize();
+        return clampSize(sf::Vector2f(preferred.x >= 0.f ? preferred.x : measured_size.x, preferred.y >= 0.f ? preferred.y : measured_size.y));
+    }
+
+    sf::Vector2f LayoutGroup::measureWidgets()
+    {
+        // Along is the axis of the orientation, across the other one.
+        bool vertical = orientation == Vertical;
+        float along = 0.f;
+        float across = 0.f;
+        if(layout == StackLayout || layout == FlexLayout)
+        {
+            for (int i = 0; i < widget_list.size(); i++)
+            {
+                sf::Vector2f size = widget_list[i]->measure();
+                along += (vertical ? size.y : size.x) + (i > 0 ? spacing : 0.f);
+                across = std::max(across, vertical ? size.x : size.y);
+            }
+        }
+        else if(layout == WrapLayout)
+        {
+            // Without a preferred size the group asks for a single row or column.
+            float limit = vertical ? getPreferredSize().y : getPreferredSize().x;
+            if(limit < 0.f) limit = std::numeric_limits<float>::max();
+            else limit -= padding * 2.f;
+
+            float line_along = 0.f;
+            float line_across = 0.f;
+            int line_start = 0;
+            for (int i = 0; i < widget_list.size(); i++)
+            {
+                sf::Vector2f size = widget_list[i]->measure();
+                float size_along = vertical ? size.y : size.x;
+                if(i > line_start && line_along + spacing + size_along > limit)
+                {
+                    along = std::max(along, line_along);
+                    across += line_across + spacing;
+                    line_along = 0.f;
+                    line_across = 0.f;
+                    line_start = i;
+                }
+                line_along += (i > line_start ? spacing : 0.f) + size_along;
+                line_across = std::max(line_across, vertical ? size.x : size.y);
+            }
+            along = std::max(along, line_along);
+            across += line_across;
+        }
+        else if(layout == GridLayout)
+        {
+            // The columns are as wide as their widest widget, the rows as high as their highest widget.
+            std::vector<float> column_widths(std::min<int>(column_count, widget_list.size()), 0.f);
+            std::vector<float> row_heights((widget_list.size() + column_count - 1) / column_count, 0.f);
+            for (int i = 0; i < widget_list.size(); i++)
+            {
+                sf::Vector2f size = widget_list[i]->measure();
+                column_widths[i % column_count] = std::max(column_widths[i % column_count], size.x);
+                row_heights[i / column_count] = std::max(row_heights[i / column_count], size.y);
+            }
+            sf::Vector2f size;
+            for (int i = 0; i < column_widths.size(); i++) size.x += column_widths[i] + (i > 0 ? spacing : 0.f);
+            for (int i = 0; i < row_heights.size(); i++) size.y += row_heights[i] + (i > 0 ? spacing : 0.f);
+            return size + sf::Vector2f(padding * 2.f, padding * 2.f);
+        }
+        sf::Vector2f size = vertical ? sf::Vector2f(across, along) : sf::Vector2f(along, across);
+        return size + sf::Vector2f(padding * 2.f, padding * 2.f);
+    }
+
+    void LayoutGroup::arrangeWidgets()
+    {
+        arrange_needed = false;
+        if(layout == ManualLayout || widget_list.size() == 0) return;
+
+        bool vertical = orientation == Vertical;
+        sf::Vector2f origin = getPosition() + sf::Vector2f(padding, padding);
+        sf::Vector2f space = getSize() - sf::Vector2f(padding * 2.f, padding * 2.f);
+        float space_along = vertical ? space.y : space.x;
+        float space_across = vertical ? space.x : space.y;
+        // Build a vector from its components along and across the orientation.
+        auto makeVector = [vertical](float p_along, float p_across)
+        {
+            return vertical ? sf::Vector2f(p_across, p_along) : sf::Vector2f(p_along, p_across);
+        };
+
+        std::vector<sf::Vector2f> sizes(widget_list.size());
+        for (int i = 0; i < widget_list.size(); i++)
+        {
+            sizes[i] = widget_list[i]->measure();
+        }
+
+        if(layout == StackLayout || layout == FlexLayout)
+        {
+            std::vector<float> lengths(widget_list.size());
+            float free_space = space_along - spacing * (widget_list.size() - 1);
+            for (int i = 0; i < widget_list.size(); i++)
+            {
+                lengths[i] = vertical ? sizes[i].y : sizes[i].x;
+                free_space -= lengths[i];
+            }
+
+            if(layout == FlexLayout)
+            {
+                // Free space is shared by the flex grow factors, missing space is taken from the widgets by how much they can shrink.
+                float total = 0.f;
+                for (int i = 0; i < widget_list.size(); i++)
+                {
+                    float min_length = vertical ? widget_list[i]->getMinSize().y : widget_list[i]->getMinSize().x;
+                    total += free_space > 0.f ? widget_list[i]->getFlexGrow() : lengths[i] - min_length;
+                }
+                for (int i = 0; total > 0.f && i < widget_list.size(); i++)
+                {
+                    Widget* widget = widget_list[i];
+                    float min_length = vertical ? widget->getMinSize().y : widget->getMinSize().x;
+                    float share = free_space > 0.f ? widget->getFlexGrow() : lengths[i] - min_length;
+                    lengths[i] += free_space * share / total;
+                }
+                // Across the orientation the widgets fill the group. Both stay within their min and max sizes.
+                for (int i = 0; i < widget_list.size(); i++)
+                {
+                    sizes[i] = widget_list[i]->clampSize(makeVector(lengths[i], space_across));
+                    lengths[i] = vertical ? sizes[i].y : sizes[i].x;
+                }
+            }
+
+            float position = 0.f;
+            for (int i = 0; i < widget_list.size(); i++)
+            {
+                placeWidget(widget_list[i], origin + makeVector(position, 0.f), sizes[i]);
+                position += lengths[i] + spacing;
+            }
+        }
+        else if(layout == WrapLayout)
+        {
+            // The widgets of a line are placed once the line is full, since the line is as thick as its thickest widget.
+            float line_along = 0.f;
+            float line_across = 0.f;
+            float position_across = 0.f;
+            int line_start = 0;
+            for (int i = 0; i <= widget_list.size(); i++)
+            {
+                float size_along = i < widget_list.size() ? (vertical ? sizes[i].y : sizes[i].x) : 0.f;
+                if(i == widget_list.size() || (i > line_start && line_along + spacing + size_along > space_along))
+                {
+                    float position = 0.f;
+                    for (int j = line_start; j < i; j++)
+                    {
+                        placeWidget(widget_list[j], origin + makeVector(position, position_across), sizes[j]);
+                        position += (vertical ? sizes[j].y : sizes[j].x) + spacing;
+                    }
+                    position_across += line_across + spacing;
+                    line_along = 0.f;
+                    line_across = 0.f;
+                    line_start = i;
+                }
+                if(i == widget_list.size()) break;
+                line_along += (i > line_start ? spacing : 0.f) + size_along;
+                line_across = std::max(line_across, vertical ? sizes[i].x : sizes[i].y);
+            }
+        }
+        else if(layout == GridLayout)
+        {
+            std::vector<float> column_positions(std::min<int>(column_count, widget_list.size()) + 1, 0.f);
+            std::vector<float> row_positions((widget_list.size() + column_count - 1) / column_count + 1, 0.f);
+            for (int i = 0; i < widget_list.size(); i++)
+            {
+                column_positions[i % column_count + 1] = std::max(column_positions[i % column_count + 1], sizes[i].x + spacing);
+                row_positions[i / column_count + 1] = std::max(row_positions[i / column_count + 1], sizes[i].y + spacing);
+            }
+            for (int i = 1; i < column_positions.size(); i++) column_positions[i] += column_positions[i - 1];
+            for (int i = 1; i < row_positions.size(); i++) row_positions[i] += row_positions[i - 1];
+            for (int i = 0; i < widget_list.size(); i++)
+            {
+                placeWidget(widget_list[i], origin + sf::Vector2f(column_positions[i % column_count], row_positions[i / column_count]), sizes[i]);
+            }
+        }
+    }
+
+    void LayoutGroup::placeWidget(Widget* p_widget, const sf::Vector2f& p_position, const sf::Vector2f& p_size)
+    {
+        // Moving a group moves all of its widgets with it, so it only needs to be arranged again if it has a new size or its widgets changed.
+        bool resized = p_widget->getSize() != p_size;
+        p_widget->setPosition(p_position);
+        p_widget->setSize(p_size);
+
+        LayoutGroup* inner_group = dynamic_cast<LayoutGroup*>(p_widget);
+        if(inner_group != nullptr && inner_group->layout != ManualLayout && (resized || inner_group->arrange_needed))
+        {
+            inner_group->arrangeWidgets();
+        }
     }
 
     void LayoutGroup::setMask(Widget* p_widget)
@@ -1312,76 +2299,238 @@ namespace jui
 
     void LayoutGroup::add(Widget* p_widget)
     {
+        // A widget is only kept in the bounds of the last group it was added to.
+        if(p_widget->group != nullptr && p_widget->group != this) p_widget->group->remove(p_widget);
+        p_widget->group = this;
         widget_list.push_back(p_widget);
+
+        // Widgets keep the size they have now in a layout, unless they are groups measuring their own widgets.
+        if(p_widget->preferred_size.x < 0.f && p_widget->preferred_size.y < 0.f && dynamic_cast<LayoutGroup*>(p_widget) == nullptr)
+        {
+            p_widget->preferred_size = p_widget->getSize();
+        }
+        invalidateLayout();
+
+        // Adding a widget can only make the bounds bigger.
+        sf::FloatRect bounds(p_widget->getPosition(), p_widget->getSize());
+        if(widget_list.size() == 1)
+        {
+            content_bounds = bounds;
+            bounds_valid = true;
+        }
+        else if(bounds_valid)
+        {
+            growBounds(bounds);
+        }
     }
 
     void LayoutGroup::remove(Widget* p_widget)
     {
-        for(int i = 0; i < widget_list.size(); i++)
+        // Widgets are often removed in the opposite order they were added in, e.g. when a list is cleared from its end.
+        for(int i = widget_list.size() - 1; i >= 0; i--)
         {
             if(widget_list[i] == p_widget)
             {
                 widget_list.erase(widget_list.begin() + i);
+                if(p_widget->group == this) p_widget->group = nullptr;
+                releaseWidget(p_widget);
+                invalidateLayout();
+                // A widget that was on an edge of the bounds takes that edge with it.
+                sf::FloatRect bounds(p_widget->getPosition(), p_widget->getSize());
+                if(bounds.left <= content_bounds.left || bounds.top <= content_bounds.top || bounds.left + bounds.width >= content_bounds.left + content_bounds.width || bounds.top + bounds.height >= content_bounds.top + content_bounds.height)
+                {
+                    bounds_valid = false;
+                }
                 return;
             }
         }
     }
 
+    void LayoutGroup::clear()
+    {
+        if(widget_list.size() > 0) invalidateLayout();
+        for (int i = 0; i < widget_list.size(); i++)
+        {
+            if(widget_list[i]->group == this) widget_list[i]->group = nullptr;
+            releaseWidget(widget_list[i]);
+        }
+        widget_list.clear();
+        content_bounds = sf::FloatRect();
+        bounds_valid = true;
+    }
+
+    void LayoutGroup::releaseWidget(Widget* p_widget)
+    {
+        // A group that waited for the layout of this group arranges itself now. Groups that are being destroyed are not groups anymore here.
+        LayoutGroup* inner_group = dynamic_cast<LayoutGroup*>(p_widget);
+        if(inner_group != nullptr && inner_group->group == nullptr && inner_group->arrange_needed)
+        {
+            canvas.requestArrange(inner_group);
+        }
+    }
+
     Widget* LayoutGroup::get(int p_index)
     {
         if(p_index < 0 || p_index >= widget_list.size()) return nullptr;
         return widget_list[p_index];
     }
 
-    int LayoutGroup::getCount()
+    int LayoutGroup::getCount() const
     {
         return widget_list.size();
     }
 
-    ScrollList::ScrollList(Canvas& p_canvas, sf::Font& p_font)
-        : Widget::Widget(p_canvas), scroll_bar(p_canvas, p_font, Orientation::Vertical), content(p_canvas)
+    void PrefixSums::assign(const std::vector<float>& p_values)
     {
-        setSize(sf::Vector2f(200.f, 300.f));
-        setOutlineColor(sf::Color(170, 170, 170));
-        setOutlineThickness(1.f);
-
-        content.setOutlineThickness(0.f);
-        content.setFillColor(sf::Color::Transparent);
-        content.setSelectable(false);
-        scroll_bar.setMask(this);
-
-        scroll_bar.setOnScrollListener([&]()
+        values = p_values;
+        // Every node adds its sum to the next node covering it, which builds the tree in O(n).
+        tree.assign(values.size() + 1, 0.0);
+        for (int i = 1; i < tree.size(); i++)
         {
-            float starting_position;
-            if(scroll_bar.getScrollState().scroll_list_length <= scroll_bar.getScrollState().scroll_handle_size) 
-            {
-                starting_position = 0;
-            }
-            else 
-            {
-                starting_position = (scroll_bar.getScrollState().scroll_handle_position / scroll_bar.getScrollState().scroll_list_length) * content.getGroupSize().y;
-            } 
-            content.setPosition(sf::Vector2f(getPosition().x, getPosition().y - starting_position));
-        });
+            tree[i] += values[i - 1];
+            int parent = i + (i & -i);
+            if(parent < tree.size()) tree[parent] += tree[i];
+        }
     }
 
-    void ScrollList::setPosition(const sf::Vector2f& p_position)
+    void PrefixSums::set(int p_index, float p_value)
     {
-        Widget::setPosition(p_position);
-        scroll_bar.setPosition(sf::Vector2f(getPosition().x + getSize().x - scrollbar_width, getPosition().y));
+        double difference = (double)p_value - values[p_index];
+        values[p_index] = p_value;
+        for (int i = p_index + 1; i < tree.size(); i += i & -i)
+        {
+            tree[i] += difference;
+        }
     }
 
-    void ScrollList::setSize(const sf::Vector2f& p_size)
+    float PrefixSums::get(int p_index) const
     {
-        Widget::setSize(p_size);
-        scroll_bar.setPosition(sf::Vector2f(getPosition().x + getSize().x - scrollbar_width, getPosition().y));
-        scroll_bar.setSize(sf::Vector2f(scrollbar_width, getSize().y));
+        return values[p_index];
+    }
+
+    int PrefixSums::getSize() const
+    {
+        return values.size();
+    }
+
+    double PrefixSums::getPrefix(int p_index) const
+    {
+        double sum = 0.0;
+        for (int i = p_index; i > 0; i -= i & -i)
+        {
+            sum += tree[i];
+        }
+        return sum;
+    }
+
+    double PrefixSums::getTotal() const
+    {
+        return getPrefix(values.size());
+    }
+
+    int PrefixSums::find(double p_offset) const
+    {
+        if(values.size() == 0) return -1;
+
+        // Walk down the tree from the biggest step, and skip every node whose sum still fits into the offset.
+        int index = 0;
+        int step = 1;
+        while(step * 2 <= values.size()) step *= 2;
+        for (; step > 0; step /= 2)
+        {
+            if(index + step < tree.size() && tree[index + step] <= p_offset)
+            {
+                index += step;
+                p_offset -= tree[index];
+            }
+        }
+        return std::min(index, (int)values.size() - 1);
+    }
+
+    ScrollList::ScrollList(Canvas& p_canvas, sf::Font& p_font)
+        : Widget::Widget(p_canvas), scroll_bar(p_canvas, p_font, Orientation::Vertical), content(p_canvas)
+    {
+        setSize(sf::Vector2f(200.f, 300.f));
+        setOutlineColor(sf::Color(170, 170, 170));
+        setOutlineThickness(1.f);
+
+        content.setOutlineThickness(0.f);
+        content.setFillColor(sf::Color::Transparent);
+        content.setSelectable(false);
+        scroll_bar.setMask(this);
+        setEventSubscription(WheelEvents);
+
+        scroll_bar.setOnScrollListener([&]()
+        {
+            float starting_position;
+            if(scroll_bar.getScrollState().scroll_list_length <= scroll_bar.getScrollState().scroll_handle_size) 
+            {
+                starting_position = 0;
+            }
+            else 
+            {
+                starting_position = (scroll_bar.getScrollState().scroll_handle_position / scroll_bar.getScrollState().scroll_list_length) * getContentLength();
+            } 
+            if(is_virtual)
+            {
+                scroll_offset = starting_position;
+                refreshRows();
+            }
+            else
+            {
+                content.setPosition(sf::Vector2f(getPosition().x, getPosition().y - starting_position));
+            }
+        });
+    }
+
+    ScrollList::~ScrollList()
+    {
+        for (int i = 0; i < rows.size(); i++)
+        {
+            delete rows[i];
+        }
+        for (int i = 0; i < spare_rows.size(); i++)
+        {
+            delete spare_rows[i];
+        }
+    }
+
+    const char* ScrollList::getTypeName() const
+    {
+        return "ScrollList";
+    }
+
+    void ScrollList::setPosition(const sf::Vector2f& p_position)
+    {
+        Widget::setPosition(p_position);
+        scroll_bar.setPosition(sf::Vector2f(getPosition().x + getSize().x - scrollbar_width, getPosition().y));
+        refreshRows();
+    }
+
+    void ScrollList::setSize(const sf::Vector2f& p_size)
+    {
+        Widget::setSize(p_size);
+        scroll_bar.setPosition(sf::Vector2f(getPosition().x + getSize().x - scrollbar_width, getPosition().y));
+        scroll_bar.setSize(sf::Vector2f(scrollbar_width, getSize().y));
+        // A virtual list shows more or fewer rows now.
+        if(is_virtual)
+        {
+            scroll_bar.setScrollState(scroll_bar.getScrollState().scroll_handle_position, getSize().y, getContentLength());
+        }
     }
 
     void ScrollList::setLayer(int p_layer)
     {
         Widget::setLayer(p_layer);
         content.setLayer(p_layer);
+        for (int i = 0; i < rows.size(); i++)
+        {
+            rows[i]->setLayer(p_layer);
+        }
+        for (int i = 0; i < spare_rows.size(); i++)
+        {
+            spare_rows[i]->setLayer(p_layer);
+        }
         scroll_bar.setLayer(p_layer);
     }
     void ScrollList::setVisible(bool p_state)
@@ -1389,33 +2538,66 @@ namespace jui
         Widget::setVisible(p_state);
         scroll_bar.setVisible(p_state);
         content.setVisible(p_state);
+        // Spare rows stay hidden.
+        for (int i = 0; i < rows.size(); i++)
+        {
+            rows[i]->setVisible(p_state);
+        }
     }
     void ScrollList::setUpdated(bool p_state)
     {
         Widget::setUpdated(p_state);
         scroll_bar.setUpdated(p_state);
         content.setUpdated(p_state);
+        for (int i = 0; i < rows.size(); i++)
+        {
+            rows[i]->setUpdated(p_state);
+        }
+        for (int i = 0; i < spare_rows.size(); i++)
+        {
+            spare_rows[i]->setUpdated(p_state);
+        }
     }
     void ScrollList::setSelectable(bool p_state)
     {
         Widget::setSelectable(p_state);
         scroll_bar.setSelectable(p_state);
         content.setSelectable(p_state);
+        for (int i = 0; i < rows.size(); i++)
+        {
+            rows[i]->setSelectable(p_state);
+        }
+        for (int i = 0; i < spare_rows.size(); i++)
+        {
+            spare_rows[i]->setSelectable(p_state);
+        }
     }
 
     void ScrollList::add(Widget* p_widget)
     {
         content.add(p_widget);
         p_widget->setMask(this);
-        setLayer(getLayer());
-        scroll_bar.setScrollState(scroll_bar.getScrollState().scroll_handle_position, getSize().y, content.getGroupSize().y);
+        // Only the new widget needs to be moved to the list's layer. The scroll bar is moved behind it, so it stays on top of the content.
+        p_widget->setLayer(getLayer());
+        scroll_bar.setLayer(getLayer());
+        scroll_bar.setScrollState(scroll_bar.getScrollState().scroll_handle_position, getSize().y, getContentLength());
     }
 
     void ScrollList::remove(Widget* p_widget)
     {
         content.remove(p_widget);
         p_widget->setMask(nullptr);
-        scroll_bar.setScrollState(scroll_bar.getScrollState().scroll_handle_position, getSize().y, content.getGroupSize().y);
+        scroll_bar.setScrollState(scroll_bar.getScrollState().scroll_handle_position, getSize().y, getContentLength());
+    }
+
+    void ScrollList::clear()
+    {
+        for (int i = 0; i < content.getCount(); i++)
+        {
+            content.get(i)->setMask(nullptr);
+        }
+        content.clear();
+        scroll_bar.setScrollState(scroll_bar.getScrollState().scroll_handle_position, getSize().y, getContentLength());
     }
 
     Widget* ScrollList::get(int p_index)
@@ -1449,28 +2631,195 @@ namespace jui
         {
             // ScrollList should only be scrollable if it or its content is hovered. An exception are ScrollLists inside ScrollLists. 
             // When hovering over the child, the parent ScrollList should not be scrollable. dynamic_cast is used to check whether the underlying widget is in fact a ScrollList.
+            // The content and the rows of a virtual list are masked to the list, so the mask of the hovered widget tells whether it belongs to the list, however long the list is.
             Widget* hovered_widget = canvas.getHovered();
             bool scrollable = hovered_widget == this;
-            if(!scrollable)
+            if(!scrollable && hovered_widget != nullptr && hovered_widget != &scroll_bar)
             {
-                for (int i = 0; i < content.getCount(); i++)
-                {
-                    if(dynamic_cast<ScrollList*>(content.get(i)) != nullptr) continue;
-                    scrollable = hovered_widget == content.get(i);
-                    if(scrollable) break;
-                }
+                scrollable = hovered_widget->getMask() == this && dynamic_cast<ScrollList*>(hovered_widget) == nullptr;
             }
 
             if(scrollable)
             {
-                scroll_bar.setScrollState(scroll_bar.getScrollState().scroll_handle_position - (10.f * p_event.mouseWheelScroll.delta), getSize().y, content.getGroupSize().y);
+                scroll_bar.setScrollState(scroll_bar.getScrollState().scroll_handle_position - (10.f * p_event.mouseWheelScroll.delta), getSize().y, getContentLength());
+            }
+        }
+    }
+
+    void ScrollList::setVirtualItems(int p_count, const std::function<float(int)>& p_height, const std::function<Widget*()>& p_create_row, const std::function<void(Widget*, int)>& p_bind_row)
+    {
+        is_virtual = true;
+        f_itemHeight = p_height;
+        f_createRow = p_create_row;
+        f_bindRow = p_bind_row;
+
+        // Rows of the old row factory do not fit anymore.
+        for (int i = 0; i < rows.size(); i++)
+        {
+            delete rows[i];
+        }
+        for (int i = 0; i < spare_rows.size(); i++)
+        {
+            delete spare_rows[i];
+        }
+        rows.clear();
+        spare_rows.clear();
+        setItemCount(p_count);
+    }
+
+    void ScrollList::setItemCount(int p_count)
+    {
+        if(!is_virtual) return;
+
+        std::vector<float> heights(p_count);
+        for (int i = 0; i < p_count; i++)
+        {
+            heights[i] = f_itemHeight(i);
+        }
+        item_heights.assign(heights);
+
+        // All rows are bound again by the scroll bar's listener.
+        spare_rows.insert(spare_rows.end(), rows.begin(), rows.end());
+        rows.clear();
+        scroll_bar.setScrollState(scroll_bar.getScrollState().scroll_handle_position, getSize().y, getContentLength());
+    }
+
+    void ScrollList::refreshItem(int p_index)
+    {
+        if(!is_virtual || p_index < 0 || p_index >= item_heights.getSize()) return;
+
+        if(p_index >= first_item && p_index < first_item + (int)rows.size())
+        {
+            f_bindRow(rows[p_index - first_item], p_index);
+        }
+        float height = f_itemHeight(p_index);
+        if(height != item_heights.get(p_index))
+        {
+            item_heights.set(p_index, height);
+            scroll_bar.setScrollState(scroll_bar.getScrollState().scroll_handle_position, getSize().y, getContentLength());
+        }
+    }
+
+    int ScrollList::getItemCount() const
+    {
+        return is_virtual ? item_heights.getSize() : content.getCount();
+    }
+
+    bool ScrollList::isVirtual() const
+    {
+        return is_virtual;
+    }
+
+    void ScrollList::scrollToItem(int p_index)
+    {
+        float position = is_virtual ? item_heights.getPrefix(p_index) : 0.f;
+        if(!is_virtual && p_index >= 0 && p_index < content.getCount())
+        {
+            position = content.get(p_index)->getPosition().y - content.getPosition().y;
+        }
+        scroll_bar.setScrollState(position, getSize().y, getContentLength());
+    }
+
+    void ScrollList::setOverscan(int p_rows)
+    {
+        overscan = p_rows;
+        refreshRows();
+    }
+
+    float ScrollList::getContentLength() const
+    {
+        return is_virtual ? item_heights.getTotal() : content.getGroupSize().y;
+    }
+
+    void ScrollList::refreshRows()
+    {
+        if(!is_virtual) return;
+
+        // Find the items in view, in O(log n) no matter how many items there are.
+        int first = 0;
+        int last = -1;
+        if(item_heights.getSize() > 0)
+        {
+            first = std::max(item_heights.find(scroll_offset) - overscan, 0);
+            last = std::min(item_heights.find(scroll_offset + getSize().y) + overscan, item_heights.getSize() - 1);
+        }
+
+        // Rows showing an item that is still in view keep it, the others are recycled.
+        std::vector<Widget*> new_rows(last - first + 1, nullptr);
+        for (int i = 0; i < rows.size(); i++)
+        {
+            int item = first_item + i;
+            if(item >= first && item <= last)
+            {
+                new_rows[item - first] = rows[i];
+            }
+            else
+            {
+                spare_rows.push_back(rows[i]);
+            }
+        }
+
+        bool created_rows = false;
+        float y = getPosition().y - scroll_offset + item_heights.getPrefix(first);
+        for (int i = 0; i < new_rows.size(); i++)
+        {
+            int item = first + i;
+            Widget*& row = new_rows[i];
+            if(row == nullptr)
+            {
+                if(spare_rows.size() > 0)
+                {
+                    row = spare_rows.back();
+                    spare_rows.pop_back();
+                }
+                else
+                {
+                    row = f_createRow();
+                    row->setMask(this);
+                    row->setLayer(getLayer());
+                    // Rows are updated and selectable by default, like their list.
+                    if(!isUpdated()) row->setUpdated(false);
+                    if(!isSelectable()) row->setSelectable(false);
+                    created_rows = true;
+                }
+                row->setVisible(isVisible());
+                f_bindRow(row, item);
             }
+            row->setSize(sf::Vector2f(getSize().x - scrollbar_width, item_heights.get(item)));
+            row->setPosition(sf::Vector2f(getPosition().x, y));
+            y += item_heights.get(item);
         }
+        for (int i = 0; i < spare_rows.size(); i++)
+        {
+            if(spare_rows[i]->isVisible()) spare_rows[i]->setVisible(false);
+        }
+        rows.swap(new_rows);
+        first_item = first;
+
+        // The scroll bar stays on top of new rows.
+        if(created_rows) scroll_bar.setLayer(getLayer());
     }
 
     DropDownList::DropDownList(Canvas& p_canvas, sf::Font& p_font)
         : font(p_font), Widget::Widget(p_canvas), dropdown_button(p_canvas, p_font), scrolllist(p_canvas, p_font)
     {
+        scrolllist.setVirtualItems(0, [](int p_index) { return 40.f; }, [this]()
+        {
+            Button* button = new Button(canvas, font);
+            button->standard_color = sf::Color(240, 240, 240);
+
+            // The button click listener gets a copy of a pointer to this DropDownList, as well as a pointer to itself.
+            button->setOnClickEvent([this, button]()
+            {
+                scrolllist.setVisible(false);
+                dropdown_button.text.setString(button->text.getString());
+                f_onDeselect();
+            });
+            return button;
+        }, [this](Widget* p_row, int p_index)
+        {
+            static_cast<Button*>(p_row)->text.setString(elements[p_index]);
+        });
         scrolllist.setVisible(false);
         setPosition(sf::Vector2f(0.f, 0.f));
         setSize(sf::Vector2f(300.f, 40.f));
@@ -1486,6 +2835,14 @@ namespace jui
 
         f_onSelect = [](){};
         f_onDeselect = [](){};
+
+        // The list is closed when clicking anywhere else.
+        setEventSubscription(NoEvents, ReleaseEvents);
+    }
+
+    const char* DropDownList::getTypeName() const
+    {
+        return "DropDownList";
     }
 
     void DropDownList::setPosition(const sf::Vector2f& p_position)
@@ -1498,14 +2855,8 @@ namespace jui
     {
         Widget::setSize(p_size);
         dropdown_button.setSize(p_size);
+        // The list resizes its buttons itself.
         scrolllist.setSize(sf::Vector2f(p_size.x, 200.f));
-
-        // Resize all buttons.
-        for (int i = 0; i < scrolllist.getCount(); i++)
-        {
-            scrolllist.get(i)->setSize(sf::Vector2f(p_size.x - scrolllist.getScrollBarWidth(), scrolllist.get(i)->getSize().y));
-        }
-        scrolllist.listWidgets(jui::Vertical);
     }
 
     void DropDownList::updateEvents(sf::Event& p_event)
@@ -1568,6 +2919,7 @@ namespace jui
     void DropDownList::setButtonColor(const sf::Color& p_color)
     {
         dropdown_button.standard_color = p_color;
+        dropdown_button.requestUpdate();
     }    
     void DropDownList::setButtonTextColor(const sf::Color& p_color)
     {
@@ -1586,31 +2938,9 @@ namespace jui
 
     void DropDownList::setList(const std::vector<sf::String>& p_elements)
     {
-        for (int i = 0; i < scrolllist.getCount(); i++)
-        {
-            Widget* current_widget = scrolllist.get(i); 
-            scrolllist.remove(current_widget);
-            delete current_widget;
-        }
-        
-        for (int i = 0; i < p_elements.size(); i++)
-        {
-            Button* button = new Button(canvas, font);
-            button->setSize(sf::Vector2f(dropdown_button.getSize().x - 20.f, 40.f));
-            button->text.setString(p_elements[i]);
-            button->standard_color = sf::Color(240, 240, 240);
-
-            // The button click listener gets a copy of a pointer to this DropDownList, as well as a pointer to itself.
-            button->setOnClickEvent([this, button]()
-            {
-                scrolllist.setVisible(false);
-                dropdown_button.text.setString(button->text.getString());
-                f_onDeselect();
-            });
- 
-            scrolllist.add(button);
-        }
-        scrolllist.listWidgets(Orientation::Vertical);
+        // Only the buttons of the elements in view are created, no matter how long the list is.
+        elements = p_elements;
+        scrolllist.setItemCount(elements.size());
         scrolllist.setVisible(false);
     }
 
@@ -1642,6 +2972,8 @@ namespace jui
         placeholder_text.setOutlineThickness(0.f);
         placeholder_text.enableWrapping(true);
         placeholder_text.setVisible(false);
+        // Clicks on the placeholder go to the input field, so it receives the keyboard events.
+        placeholder_text.setSelectable(false);
         cursor.setFillColor(sf::Color::Black);
         cursor.setOutlineThickness(0.f);
         cursor.setMask(this);
@@ -1652,6 +2984,14 @@ namespace jui
         f_customIsCharValid = [](sf::Uint32 p_char){ return true; };
         f_onSelect = [](){};
         f_onDeselect = [](){};
+
+        // Presses and mouse movement are needed to notice when the input field is deselected or left by the mouse.
+        setEventSubscription(KeyEvents | TextEvents | ReleaseEvents, PressEvents | MoveEvents);
+    }
+
+    const char* InputField::getTypeName() const
+    {
+        return "InputField";
     }
 
     void InputField::setPosition(const sf::Vector2f& p_position)
@@ -1675,6 +3015,7 @@ namespace jui
         cursor_index = p_string.getSize();
         drag_cursor_index = cursor_index;
         refreshCursor();
+        requestUpdate();
     }
 
     const sf::String& InputField::getString()
@@ -1772,19 +3113,21 @@ namespace jui
             }
         }
 
-        // Make the text cursor blink.
+        // Make the text cursor blink. The field is updated again when the cursor has to change the next time.
         if(isSelected())
         {
-            blinking_timer += Canvas::getDeltaTime();
+            blinking_timer += blinking_clock.restart().asSeconds();
             if(blinking_timer >= blinking_interval)
             {
                 cursor.setVisible(!cursor.isVisible());
                 blinking_timer = 0.f;
             }
+            scheduleUpdate(blinking_interval - blinking_timer);
         }
         else
         {
             cursor.setVisible(false);
+            blinking_clock.restart();
         }
 
         // Update visibility of the placeholder text.
@@ -1792,12 +3135,15 @@ namespace jui
 
         if(is_making_mouse_selection)
         {
-            drag_cursor_index = text.findIndex(getMousePosition(window, &view));
+            drag_cursor_index = text.findIndex(canvas.getMousePosition());
             moveTextHorizontally(drag_cursor_index);
 
             cursor.setPosition(text.findCharacterPos(cursor_index));
             text.setSelection(std::min(drag_cursor_index, cursor_index), std::max(drag_cursor_index, cursor_index));
         }
+
+        // The mouse selection follows the mouse every frame.
+        setUpdatedEveryFrame(is_making_mouse_selection);
     }
 
     void InputField::updateEvents(sf::Event& p_event)
@@ -1879,7 +3225,7 @@ namespace jui
             {
                 if(p_event.mouseButton.button == sf::Mouse::Left)
                 {
-                    cursor_index = text.findIndex(getMousePosition(window, &view));
+                    cursor_index = text.findIndex(canvas.getMousePosition());
                     refreshCursor();
                     drag_cursor_index = cursor_index;
                     is_making_mouse_selection = true;
@@ -1926,11 +3272,9 @@ namespace jui
                 bool made_selection = cursor_index != drag_cursor_index;
                 if(made_selection)
                 {
-                    sf::String modified_string = text.getString();
-                    modified_string.erase(std::min(cursor_index, drag_cursor_index), std::abs(cursor_index - drag_cursor_index));
+                    text.erase(std::min(cursor_index, drag_cursor_index), std::abs(cursor_index - drag_cursor_index));
                     cursor_index = std::min(cursor_index, drag_cursor_index);
                     drag_cursor_index = cursor_index;
-                    text.setString(modified_string);
                     refreshCursor();
                     text.setSelection(std::min(drag_cursor_index, cursor_index), std::max(drag_cursor_index, cursor_index));
                 }
@@ -1958,9 +3302,7 @@ namespace jui
                     {
                         toInsert = toUppercase(toInsert);
                     }
-                    sf::String modified_string = text.getString();
-                    modified_string.insert(cursor_index, toInsert);
-                    text.setString(modified_string);
+                    text.insert(cursor_index, toInsert);
                     cursor_index += toInsert.getSize();
                     drag_cursor_index = cursor_index;
                     refreshCursor();
@@ -1972,9 +3314,7 @@ namespace jui
                 {
                     if(cursor_index > 0 && !made_selection)
                     {
-                        sf::String modified_string = text.getString();
-                        modified_string.erase(cursor_index - 1);
-                        text.setString(modified_string);
+                        text.erase(cursor_index - 1);
                         cursor_index--;
                         drag_cursor_index = cursor_index;
                         refreshCursor();
@@ -1983,13 +3323,11 @@ namespace jui
                 // On valid character input.
                 else if(isCharValid(input) && text.getString().getSize() < max_character_limit)
                 {
-                    sf::String modified_string = text.getString();
                     if(type & Capitalized)
                     {
                         input = toUppercase(input);
                     }
-                    modified_string.insert(cursor_index, input);
-                    text.setString(modified_string);
+                    text.insert(cursor_index, input);
                     cursor_index++;
                     refreshCursor();
                     drag_cursor_index = cursor_index;
@@ -2021,11 +3359,11 @@ namespace jui
 
             if(is_currently_hovered && !was_hovered)
             {
-                Cursor::setCursor(sf::Cursor::Text, window);
+                canvas.getInput().setMouseCursor(sf::Cursor::Text);
             }
             if(!is_currently_hovered && was_hovered)
             {
-                Cursor::setCursor(sf::Cursor::Arrow, window);
+                canvas.getInput().setMouseCursor(sf::Cursor::Arrow);
             }
 
             was_hovered = is_currently_hovered;
@@ -2087,7 +3425,6 @@ namespace jui
     {
         Widget::setSelectable(p_state);
         text.setSelectable(p_state);
-        placeholder_text.setSelectable(p_state);
         cursor.setSelectable(p_state);
     }
 
@@ -2198,210 +3535,1689 @@ namespace jui
         }
     }
 
-    float Canvas::s_delta_time;
+    QuadBatch::QuadBatch(sf::RenderTarget& p_target)
+        : target(&p_target)
+    {
+    }
 
-    Canvas::Canvas(sf::RenderWindow& p_window)
-        : window(p_window)
+    void QuadBatch::addRectangle(const sf::FloatRect& p_rectangle, const sf::Color& p_color, const sf::FloatRect& p_clip)
     {
-        view.reset(sf::FloatRect(0.f, 0.f, window.getSize().x, window.getSize().y));
-        view.setViewport(sf::FloatRect(0.f, 0.f, 1.f, 1.f));
+        // Untextured quads sample the white texel, in case they share a draw call with a font texture.
+        addTexturedRectangle(p_rectangle, sf::FloatRect(1.f, 1.f, 0.f, 0.f), nullptr, p_color, p_clip);
     }
-    
-    void Canvas::drawAll() 
+
+    void QuadBatch::addTexturedRectangle(const sf::FloatRect& p_rectangle, const sf::FloatRect& p_texture_rect, const sf::Texture* p_texture, const sf::Color& p_color, const sf::FloatRect& p_clip, bool p_white_texel)
     {
-        // Save the current view as copy and assign new one.
-        sf::View currentView = window.getView();
+        // Clip the quad and cut off the same part of the texture rectangle.
+        sf::FloatRect clipped;
+        if(!p_rectangle.intersects(p_clip, clipped)) return;
+        if(has_scissor && !clipped.intersects(scissor, clipped)) return;
 
-        // Draw visible widgets.
-        for (int i = 0; i < widget_list.size(); i++)
+        if(is_measuring)
         {
-            if(widget_list[i]->isVisible())
-            {
-                widget_list[i]->draw();
-            }
+            measured_bounds = combineRectangles(measured_bounds, clipped);
+            return;
         }
 
-        window.setView(view);
+        float u1 = p_texture_rect.left + (clipped.left - p_rectangle.left) / p_rectangle.width * p_texture_rect.width;
+        float u2 = p_texture_rect.left + (clipped.left + clipped.width - p_rectangle.left) / p_rectangle.width * p_texture_rect.width;
+        float v1 = p_texture_rect.top + (clipped.top - p_rectangle.top) / p_rectangle.height * p_texture_rect.height;
+        float v2 = p_texture_rect.top + (clipped.top + clipped.height - p_rectangle.top) / p_rectangle.height * p_texture_rect.height;
+        float right = clipped.left + clipped.width;
+        float bottom = clipped.top + clipped.height;
 
-        // Draw here.
+        useTexture(p_texture, p_white_texel);
 
-        window.setView(currentView);
+        // Every quad is made up from two triangles.
+        vertices.push_back(sf::Vertex(sf::Vector2f(clipped.left, bottom), p_color, sf::Vector2f(u1, v2)));
+        vertices.push_back(sf::Vertex(sf::Vector2f(clipped.left, clipped.top), p_color, sf::Vector2f(u1, v1)));
+        vertices.push_back(sf::Vertex(sf::Vector2f(right, clipped.top), p_color, sf::Vector2f(u2, v1)));
+        vertices.push_back(sf::Vertex(sf::Vector2f(clipped.left, bottom), p_color, sf::Vector2f(u1, v2)));
+        vertices.push_back(sf::Vertex(sf::Vector2f(right, clipped.top), p_color, sf::Vector2f(u2, v1)));
+        vertices.push_back(sf::Vertex(sf::Vector2f(right, bottom), p_color, sf::Vector2f(u2, v2)));
+        statistics.quads++;
     }
-    
-    void Canvas::updateAllLogic() 
+
+    void QuadBatch::addQuads(const sf::VertexArray& p_vertices, const sf::Vector2f& p_offset, const sf::Texture* p_texture, const sf::FloatRect& p_clip, bool p_white_texel)
     {
-        // Updates of all widgets.
-        for (int i = 0; i < widget_list.size(); i++)
+        for (std::size_t i = 0; i + 5 < p_vertices.getVertexCount(); i += 6)
         {
-            if(widget_list[i]->isUpdated() && widget_list[i]->isVisible())
+            // Find the corners of the quad, no matter in which order its vertices are.
+            sf::Vector2f min_position = p_vertices[i].position, max_position = p_vertices[i].position;
+            sf::Vector2f min_texture = p_vertices[i].texCoords, max_texture = p_vertices[i].texCoords;
+            for (std::size_t j = i + 1; j < i + 6; j++)
             {
-                widget_list[i]->updateLogic();
+                if(p_vertices[j].position.x < min_position.x) { min_position.x = p_vertices[j].position.x; min_texture.x = p_vertices[j].texCoords.x; }
+                if(p_vertices[j].position.y < min_position.y) { min_position.y = p_vertices[j].position.y; min_texture.y = p_vertices[j].texCoords.y; }
+                if(p_vertices[j].position.x > max_position.x) { max_position.x = p_vertices[j].position.x; max_texture.x = p_vertices[j].texCoords.x; }
+                if(p_vertices[j].position.y > max_position.y) { max_position.y = p_vertices[j].position.y; max_texture.y = p_vertices[j].texCoords.y; }
             }
-        }
 
-        Canvas::s_delta_time = clock.restart().asSeconds();
-    }
-    
-    void Canvas::updateAllEvents(sf::Event& p_event) 
-    {
-        if(p_event.type == sf::Event::MouseButtonPressed)
-        {
-            if(p_event.mouseButton.button == sf::Mouse::Left)
-            {     
-                // Set selected widget.
-                std::vector<int> widgets_under_mouse;
-                for (int i = 0; i < widget_list.size(); i++)
-                {
-                    if(widget_list[i]->mouseOver() && widget_list[i]->isSelectable() && widget_list[i]->isVisible())
-                    {
-                        widgets_under_mouse.push_back(i);
-                    }
-                }
-                if(widgets_under_mouse.size() == 0)
-                {
-                    select(nullptr);
-                }
-                else
-                {
-                    int selected_widget_index = widgets_under_mouse[widgets_under_mouse.size() - 1];
-                    select(widget_list[selected_widget_index]);
-                }
-            }
-        }
-        if(p_event.type == sf::Event::Resized)
-        {
-            // Reset views.
-            for (int i = 0; i < widget_list.size(); i++)
+            sf::FloatRect rectangle(min_position + p_offset, max_position - min_position);
+            if(p_texture != nullptr)
             {
-                widget_list[i]->setPosition(widget_list[i]->getPosition());
+                addTexturedRectangle(rectangle, sf::FloatRect(min_texture, max_texture - min_texture), p_texture, p_vertices[i].color, p_clip, p_white_texel);
             }
-            view.reset(sf::FloatRect(0.f, 0.f, window.getSize().x, window.getSize().y));
-            view.setViewport(sf::FloatRect(0.f, 0.f, 1.f, 1.f));
-        }
-        if(p_event.type == sf::Event::MouseMoved)
-        {
-            std::vector<int> widgets_under_mouse;
-            for (int i = 0; i < widget_list.size(); i++)
+            else
             {
-                if(widget_list[i]->mouseOver() && widget_list[i]->isSelectable() && widget_list[i]->isVisible())
-                {
-                    widgets_under_mouse.push_back(i);
-                }
+                addRectangle(rectangle, p_vertices[i].color, p_clip);
             }
-            hovered_widget = widgets_under_mouse.size() ? widget_list[widgets_under_mouse[widgets_under_mouse.size() - 1]] : nullptr;
         }
+    }
 
-        if(p_event.type == sf::Event::KeyPressed)
-        {
-            if(p_event.key.code == sf::Keyboard::F12)
+    void QuadBatch::flush()
+    {
+        if(vertices.size() == 0) return;
+
+        sf::RenderStates states;
+        states.texture = texture;
+        states.blendMode = blend_mode;
+        target->draw(&vertices[0], vertices.size(), sf::Triangles, states);
+        statistics.draw_calls++;
+
+        // Clearing keeps the memory, so the vertices do not need to be allocated again.
+        vertices.clear();
+    }
+
+    void QuadBatch::setTarget(sf::RenderTarget& p_target)
+    {
+        flush();
+        target = &p_target;
+    }
+
+    sf::RenderTarget& QuadBatch::getTarget() const
+    {
+        return *target;
+    }
+
+    void QuadBatch::setBlendMode(const sf::BlendMode& p_blend_mode)
+    {
+        if(blend_mode == p_blend_mode) return;
+        flush();
+        blend_mode = p_blend_mode;
+    }
+
+    void QuadBatch::setScissor(const sf::FloatRect& p_rectangle)
+    {
+        scissor = p_rectangle;
+        has_scissor = true;
+    }
+
+    void QuadBatch::removeScissor()
+    {
+        has_scissor = false;
+    }
+
+    void QuadBatch::beginMeasure()
+    {
+        is_measuring = true;
+        measured_bounds = sf::FloatRect();
+    }
+
+    sf::FloatRect QuadBatch::endMeasure()
+    {
+        is_measuring = false;
+        return measured_bounds;
+    }
+
+    const QuadBatch::Statistics& QuadBatch::getStatistics() const
+    {
+        return statistics;
+    }
+
+    void QuadBatch::resetStatistics()
+    {
+        statistics = Statistics();
+    }
+
+    void QuadBatch::useTexture(const sf::Texture* p_texture, bool p_white_texel)
+    {
+        if(p_texture == texture) return;
+
+        // Untextured quads can be drawn with a texture that has a white texel.
+        if(p_texture == nullptr && texture_has_white_texel) return;
+
+        // The untextured quads drawn so far can be drawn with the new texture, if it has a white texel.
+        if(texture == nullptr && p_white_texel)
+        {
+            texture = p_texture;
+            texture_has_white_texel = true;
+            return;
+        }
+
+        flush();
+        texture = p_texture;
+        texture_has_white_texel = p_white_texel;
+    }
+
+    WorkerPool::WorkerPool(unsigned int p_thread_count)
+        : next_job(0)
+    {
+        for (unsigned int i = 0; i < p_thread_count; i++)
+        {
+            threads.emplace_back(&WorkerPool::work, this);
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    void WorkerPool::run(int p_job_count, const std::function<void(int)>& p_job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &p_job;
+            job_count = p_job_count;
+            next_job = 0;
+            busy_workers = threads.size();
+            generation++;
+        }
+        work_available.notify_all();
+
+        // The calling thread works as well instead of only waiting.
+        runJobs();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        work_done.wait(lock, [&]() { return busy_workers == 0; });
+        job = nullptr;
+    }
+
+    unsigned int WorkerPool::getThreadCount() const
+    {
+        return threads.size();
+    }
+
+    void WorkerPool::work()
+    {
+        unsigned int last_generation = 0;
+        while(true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_available.wait(lock, [&]() { return stopping || generation != last_generation; });
+                if(stopping) return;
+                last_generation = generation;
+            }
+
+            runJobs();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy_workers--;
+            }
+            work_done.notify_one();
+        }
+    }
+
+    void WorkerPool::runJobs()
+    {
+        for (int i = next_job++; i < job_count; i = next_job++)
+        {
+            (*job)(i);
+        }
+    }
+
+    void InputSource::handleEvent(const sf::Event& p_event)
+    {
+    }
+
+    void InputSource::setMouseCursor(sf::Cursor::Type p_type)
+    {
+    }
+
+    WindowInput::WindowInput(sf::RenderWindow& p_window)
+        : window(p_window)
+    {
+    }
+
+    sf::Vector2i WindowInput::getMousePosition() const
+    {
+        return sf::Mouse::getPosition(window);
+    }
+
+    bool WindowInput::isMouseButtonPressed(sf::Mouse::Button p_button) const
+    {
+        // SFML does not know which window the button was pressed in.
+        return sf::Mouse::isButtonPressed(p_button);
+    }
+
+    void WindowInput::setMouseCursor(sf::Cursor::Type p_type)
+    {
+        Cursor::setCursor(p_type, window);
+    }
+
+    void EventInput::handleEvent(const sf::Event& p_event)
+    {
+        if(p_event.type == sf::Event::MouseMoved)
+        {
+            mouse_position = sf::Vector2i(p_event.mouseMove.x, p_event.mouseMove.y);
+        }
+        if(p_event.type == sf::Event::MouseButtonPressed || p_event.type == sf::Event::MouseButtonReleased)
+        {
+            mouse_position = sf::Vector2i(p_event.mouseButton.x, p_event.mouseButton.y);
+            mouse_buttons[p_event.mouseButton.button] = p_event.type == sf::Event::MouseButtonPressed;
+        }
+        if(p_event.type == sf::Event::MouseWheelScrolled)
+        {
+            mouse_position = sf::Vector2i(p_event.mouseWheelScroll.x, p_event.mouseWheelScroll.y);
+        }
+    }
+
+    sf::Vector2i EventInput::getMousePosition() const
+    {
+        return mouse_position;
+    }
+
+    bool EventInput::isMouseButtonPressed(sf::Mouse::Button p_button) const
+    {
+        return mouse_buttons[p_button];
+    }
+
+    float Canvas::s_delta_time;
+
+    Canvas::Canvas(sf::RenderWindow& p_window)
+        : target(p_window), batch(p_window), window(&p_window), own_input(new WindowInput(p_window))
+    {
+        input = own_input.get();
+        refreshSize();
+    }
+
+    Canvas::Canvas(sf::RenderTarget& p_target, InputSource* p_input)
+        : target(p_target), batch(p_target), input(p_input)
+    {
+        // Without an input source the canvas only knows what the events tell.
+        if(input == nullptr)
+        {
+            own_input.reset(new EventInput());
+            input = own_input.get();
+        }
+        refreshSize();
+    }
+    
+    template<typename F>
+    void Canvas::profileCall(Widget* p_widget, float Profile::* p_time, int Profile::* p_count, F p_call)
+    {
+        if(!profiling)
+        {
+            p_call();
+            return;
+        }
+
+        // The profile is created before the call, since the call might remove the widget. Then its profile is gone afterwards.
+        // The canvas only calls widgets that are fully constructed, so this is also when the actual type of the widget is known.
+        Profile& profile = getProfile(p_widget);
+        profile.type = p_widget->getTypeName();
+        profile.*p_count += 1;
+        sf::Clock clock;
+        p_call();
+        float time = clock.getElapsedTime().asMicroseconds() / 1000.f;
+
+        auto called_profile = widget_profiles.find(p_widget);
+        if(called_profile != widget_profiles.end())
+        {
+            called_profile->second.*p_time += time;
+        }
+    }
+
+    void Canvas::drawAll() 
+    {
+        // Save the current view as copy and assign new one. All widgets are drawn with the canvas' view and clip their quads themselves.
+        sf::View currentView = target.getView();
+        batch.resetStatistics();
+        frame_counter++;
+        if(profiling) profiled_frames++;
+
+        applyPendingResize();
+        arrangeLayoutGroups();
+        layoutTextFields();
+        refreshCaches();
+        if(partial_redraw)
+        {
+            redrawDirtyRegion();
+        }
+        // Partial redraws are turned off again if the frame could not be created.
+        if(partial_redraw)
+        {
+            // The colors in the frame are already multiplied with their alpha, because they were blended onto a transparent texture.
+            target.setView(view);
+            target.draw(sf::Sprite(frame.getTexture()), sf::RenderStates(sf::BlendMode(sf::BlendMode::One, sf::BlendMode::OneMinusSrcAlpha)));
+            target.setView(currentView);
+            redraw_needed = false;
+            return;
+        }
+
+        target.setView(view);
+
+        // Find the visible widgets that draw to the window and draw them.
+        collectDrawList(getBounds());
+        drawDrawList();
+
+        // Draw here.
+        batch.flush();
+
+        target.setView(currentView);
+        // Changes made while drawing, like refreshed caches, are already part of this frame.
+        redraw_needed = false;
+    }
+    
+    void Canvas::updateAllLogic() 
+    {
+        // Widgets removed during the last frame are unlinked once per frame.
+        compact();
+
+        // Scheduled updates that are due are done in this frame. The heap hands them out in the order they are due.
+        float time = timer_clock.getElapsedTime().asSeconds();
+        while(scheduled_widgets.size() > 0 && scheduled_widgets[0]->scheduled_update_time <= time)
+        {
+            Widget* widget = scheduled_widgets[0];
+            unschedule(widget);
+            widget->requestUpdate();
+        }
+
+        // Update the widgets that requested it. Updates requested while updating are done in the next frame.
+        iteration_depth++;
+        int update_count = update_queue.size();
+        for (int i = 0; i < update_count; i++)
+        {
+            Widget* widget = update_queue[i];
+            if(widget == nullptr) continue;
+            widget->update_queue_position = -1;
+
+            if(widget->isUpdated() && widget->isVisible() && !widget->isUpdatedEveryFrame())
+            {
+                profileCall(widget, &Profile::logic_time, &Profile::logic_count, [&]() { widget->updateLogic(); });
+            }
+        }
+        update_queue.erase(update_queue.begin(), update_queue.begin() + update_count);
+        for (int i = 0; i < update_queue.size(); i++)
+        {
+            if(update_queue[i] != nullptr) update_queue[i]->update_queue_position = i;
+        }
+
+        // Update the widgets that are updated every frame.
+        for (int i = 0; i < every_frame_widgets.size(); i++)
+        {
+            Widget* widget = every_frame_widgets[i];
+            if(widget == nullptr) continue;
+
+            if(widget->isUpdated() && widget->isVisible())
+            {
+                profileCall(widget, &Profile::logic_time, &Profile::logic_count, [&]() { widget->updateLogic(); });
+            }
+        }
+        iteration_depth--;
+
+        Canvas::s_delta_time = clock.restart().asSeconds();
+    }
+    
+    void Canvas::updateAllEvents(sf::Event& p_event) 
+    {
+        input->handleEvent(p_event);
+
+        if(p_event.type == sf::Event::MouseButtonPressed)
+        {
+            if(p_event.mouseButton.button == sf::Mouse::Left)
+            {     
+                // Set selected widget. The position of the event is used instead of the current mouse position, so synthetic events work as well.
+                select(findWidgetAt(target.mapPixelToCoords(sf::Vector2i(p_event.mouseButton.x, p_event.mouseButton.y), view)));
+            }
+        }
+        // The window might show garbage after it was resized or covered by other windows.
+        if(p_event.type == sf::Event::Resized || p_event.type == sf::Event::GainedFocus)
+        {
+            redraw_needed = true;
+        }
+        if(p_event.type == sf::Event::Resized)
+        {
+            resize_pending = true;
+        }
+        else
+        {
+            applyPendingResize();
+        }
+        if(p_event.type == sf::Event::MouseMoved)
+        {
+            // Widgets reacting to the mouse hovering them are updated when it enters or leaves them.
+            Widget* widget = findWidgetAt(target.mapPixelToCoords(sf::Vector2i(p_event.mouseMove.x, p_event.mouseMove.y), view));
+            if(widget != hovered_widget)
+            {
+                requestUpdates(hovered_widget);
+                hovered_widget = widget;
+                requestUpdates(hovered_widget);
+            }
+        }
+        if(p_event.type == sf::Event::MouseButtonPressed || p_event.type == sf::Event::MouseButtonReleased)
+        {
+            requestUpdates(hovered_widget);
+        }
+
+        // Send the event to the widget it is meant for and the masks of that widget, then to all widgets receiving every event of its category.
+        unsigned int category = getEventCategory(p_event.type);
+        Widget* event_target = nullptr;
+        if(category == WheelEvents || category == MoveEvents)
+        {
+            event_target = hovered_widget;
+        }
+        else if(category != OtherEvents)
+        {
+            event_target = selected_widget;
+        }
+
+        iteration_depth++;
+        event_targets.clear();
+        for (Widget* widget = event_target; widget != nullptr; widget = widget->mask)
+        {
+            widget->event_target_position = event_targets.size();
+            event_targets.push_back(widget);
+        }
+        for (int i = 0; i < event_targets.size(); i++)
+        {
+            Widget* widget = event_targets[i];
+            if(widget == nullptr) continue;
+
+            // Widgets receiving all events of the category get the event below.
+            if((widget->routed_events & category) && !(widget->global_events & category) && widget->isUpdated() && widget->isVisible())
+            {
+                profileCall(widget, &Profile::event_time, &Profile::event_count, [&]() { widget->updateEvents(p_event); });
+                if(event_targets[i] != nullptr) widget->requestUpdate();
+            }
+        }
+        for (int i = 0; i < event_targets.size(); i++)
+        {
+            if(event_targets[i] != nullptr) event_targets[i]->event_target_position = -1;
+        }
+        event_targets.clear();
+        
+        std::vector<Widget*>& subscribers = global_subscribers[getEventCategoryIndex(category)];
+        for (int i = 0; i < subscribers.size(); i++)
+        {
+            Widget* widget = subscribers[i];
+            if(widget == nullptr) continue;
+
+            if(widget->isUpdated() && widget->isVisible())
+            {
+                profileCall(widget, &Profile::event_time, &Profile::event_count, [&]() { widget->updateEvents(p_event); });
+                if(subscribers[i] != nullptr) widget->requestUpdate();
+            }
+        }
+        iteration_depth--;
+    }
+
+    void Canvas::refreshClipping(Widget* p_widget, bool p_force)
+    {
+        // A widget is popped before the widgets masked to it are pushed, so masks are always clipped before the widgets they clip.
+        clip_stack.push_back(p_widget);
+        while(clip_stack.size() > 0)
+        {
+            Widget* widget = clip_stack.back();
+            clip_stack.pop_back();
+            if(profiling) getProfile(widget).view_refreshes++;
+            if(widget->clipToMask() || p_force)
+            {
+                clip_stack.insert(clip_stack.end(), widget->masked_widgets.begin(), widget->masked_widgets.end());
+            }
+        }
+    }
+
+    void Canvas::refreshSize()
+    {
+        resize_pending = false;
+        view.reset(sf::FloatRect(0.f, 0.f, target.getSize().x, target.getSize().y));
+        view.setViewport(sf::FloatRect(0.f, 0.f, 1.f, 1.f));
+        redraw_needed = true;
+
+        // Reset views. Refreshing the views also registers the widgets in the resized hit grid again.
+        resetHitGrid();
+        for (auto& layer : layers)
+        {
+            for (int i = layer.second.first; i != -1; i = slots[i].next)
+            {
+                Widget* widget = slots[i].widget;
+                if(widget == nullptr || widget->getMask() != nullptr) continue;
+
+                // The views depend on the size of the target, so the whole mask tree is refreshed from its roots.
+                refreshClipping(widget, true);
+            }
+        }
+
+        // Anchored widgets follow the new size. Widgets that are already at their anchored place are not touched.
+        applying_anchors = true;
+        for (int i = 0; i < anchored_widgets.size(); i++)
+        {
+            anchored_widgets[i]->applyAnchor(view.getSize());
+        }
+        applying_anchors = false;
+    }
+
+    void Canvas::applyPendingResize()
+    {
+        if(resize_pending) refreshSize();
+    }
+
+    void Canvas::addAnchored(Widget* p_widget)
+    {
+        p_widget->anchored_position = anchored_widgets.size();
+        anchored_widgets.push_back(p_widget);
+    }
+
+    void Canvas::removeAnchored(Widget* p_widget)
+    {
+        // The order does not matter, so the last widget takes the place of the removed one.
+        int position = p_widget->anchored_position;
+        anchored_widgets[position] = anchored_widgets.back();
+        anchored_widgets[position]->anchored_position = position;
+        anchored_widgets.pop_back();
+        p_widget->anchored_position = -1;
+    }
+
+    void Canvas::addCached(Widget* p_widget)
+    {
+        p_widget->cached_position = cached_widgets.size();
+        cached_widgets.push_back(p_widget);
+    }
+
+    void Canvas::removeCached(Widget* p_widget)
+    {
+        // The order does not matter, caches are sorted by their depth before they are drawn.
+        int position = p_widget->cached_position;
+        cached_widgets[position] = cached_widgets.back();
+        cached_widgets[position]->cached_position = position;
+        cached_widgets.pop_back();
+        p_widget->cached_position = -1;
+    }
+
+    void Canvas::schedule(Widget* p_widget)
+    {
+        if(p_widget->scheduled_position == -1)
+        {
+            p_widget->scheduled_position = scheduled_widgets.size();
+            scheduled_widgets.push_back(p_widget);
+        }
+        // A widget only ever schedules an earlier update than the one it has, so it can only move up.
+        siftScheduledUp(p_widget->scheduled_position);
+    }
+
+    void Canvas::unschedule(Widget* p_widget)
+    {
+        // The last widget takes the place of the removed one, and is moved to where it belongs from there.
+        int position = p_widget->scheduled_position;
+        swapScheduled(position, scheduled_widgets.size() - 1);
+        scheduled_widgets.pop_back();
+        p_widget->scheduled_position = -1;
+        p_widget->scheduled_update_time = -1.f;
+        if(position < scheduled_widgets.size())
+        {
+            siftScheduledUp(position);
+            siftScheduledDown(position);
+        }
+    }
+
+    void Canvas::siftScheduledUp(int p_position)
+    {
+        while(p_position > 0)
+        {
+            int parent = (p_position - 1) / 2;
+            if(scheduled_widgets[parent]->scheduled_update_time <= scheduled_widgets[p_position]->scheduled_update_time) break;
+            swapScheduled(parent, p_position);
+            p_position = parent;
+        }
+    }
+
+    void Canvas::siftScheduledDown(int p_position)
+    {
+        while(true)
+        {
+            int earliest = p_position;
+            for (int child = 2 * p_position + 1; child <= 2 * p_position + 2 && child < scheduled_widgets.size(); child++)
+            {
+                if(scheduled_widgets[child]->scheduled_update_time < scheduled_widgets[earliest]->scheduled_update_time) earliest = child;
+            }
+            if(earliest == p_position) break;
+            swapScheduled(earliest, p_position);
+            p_position = earliest;
+        }
+    }
+
+    void Canvas::swapScheduled(int p_first, int p_second)
+    {
+        std::swap(scheduled_widgets[p_first], scheduled_widgets[p_second]);
+        scheduled_widgets[p_first]->scheduled_position = p_first;
+        scheduled_widgets[p_second]->scheduled_position = p_second;
+    }
+
+    void Canvas::setLayoutThreads(unsigned int p_count)
+    {
+        layout_thread_count = p_count;
+        layout_pool.reset();
+    }
+
+    unsigned int Canvas::getLayoutThreads() const
+    {
+        return layout_thread_count;
+    }
+
+    void Canvas::requestArrange(LayoutGroup* p_group)
+    {
+        if(p_group->pending_arrange_position != -1) return;
+        p_group->pending_arrange_position = pending_arranges.size();
+        pending_arranges.push_back(p_group);
+    }
+
+    void Canvas::cancelArrange(LayoutGroup* p_group)
+    {
+        int position = p_group->pending_arrange_position;
+        pending_arranges[position] = pending_arranges.back();
+        pending_arranges[position]->pending_arrange_position = position;
+        pending_arranges.pop_back();
+        p_group->pending_arrange_position = -1;
+    }
+
+    void Canvas::arrangeLayoutGroups()
+    {
+        // Every group removes itself from the list when it is arranged.
+        while(pending_arranges.size() > 0)
+        {
+            pending_arranges.back()->updateLayout();
+        }
+    }
+
+    void Canvas::requestLayout(TextField* p_text_field)
+    {
+        if(p_text_field->pending_layout_position != -1) return;
+        p_text_field->pending_layout_position = pending_layouts.size();
+        pending_layouts.push_back(p_text_field);
+    }
+
+    void Canvas::cancelLayout(TextField* p_text_field)
+    {
+        // The order does not matter, so the last text field takes the place of the removed one.
+        int position = p_text_field->pending_layout_position;
+        pending_layouts[position] = pending_layouts.back();
+        pending_layouts[position]->pending_layout_position = position;
+        pending_layouts.pop_back();
+        p_text_field->pending_layout_position = -1;
+    }
+
+    void Canvas::layoutTextFields()
+    {
+        if(pending_layouts.size() == 0) return;
+
+        // Only visible text fields are drawn in this frame. The others stay pending until they are shown.
+        std::vector<TextField*>& text_fields = visible_layouts;
+        text_fields.clear();
+        for (TextField* text_field : pending_layouts)
+        {
+            if(text_field->isVisible()) text_fields.push_back(text_field);
+        }
+        if(layout_thread_count == 0 || text_fields.size() < s_min_parallel_layouts)
+        {
+            for (TextField* text_field : text_fields)
+            {
+                text_field->ensureGeometryUpdate();
+            }
+            return;
+        }
+
+        // Everything that touches the fonts happens on the main thread, before the workers start. The workers start from the current geometries, so edits only lay out the lines around them.
+        std::vector<TextField::Layout> layouts(text_fields.size());
+        std::vector<TextField::Geometry> geometries(text_fields.size());
+        for (int i = 0; i < text_fields.size(); i++)
+        {
+            text_fields[i]->prepareLayout(layouts[i]);
+            std::swap(geometries[i], text_fields[i]->geometry);
+        }
+
+        if(layout_pool == nullptr) layout_pool.reset(new WorkerPool(layout_thread_count));
+        layout_pool->run(text_fields.size(), [&](int p_index)
+        {
+            TextField::computeLayout(layouts[p_index], geometries[p_index]);
+        });
+
+        // The results are only published once all of them are done, so no text field is drawn half laid out.
+        for (int i = 0; i < text_fields.size(); i++)
+        {
+            text_fields[i]->applyLayout(geometries[i]);
+        }
+    }
+
+    void Canvas::requestUpdates(Widget* p_widget)
+    {
+        for (Widget* widget = p_widget; widget != nullptr; widget = widget->mask)
+        {
+            widget->requestUpdate();
+        }
+    }
+
+    bool Canvas::waitEvent(sf::Event& p_event, sf::Time p_timeout)
+    {
+        // Without a timeout the thread sleeps until the operating system delivers the next event.
+        if(p_timeout < sf::Time::Zero) return window->waitEvent(p_event);
+
+        // SFML cannot wait for an event with a timeout, so the window is polled between short sleeps instead.
+        sf::Clock clock;
+        while(!window->pollEvent(p_event))
+        {
+            sf::Time remaining = p_timeout - clock.getElapsedTime();
+            if(remaining <= sf::Time::Zero) return false;
+            sf::sleep(std::min(remaining, sf::milliseconds(s_poll_interval)));
+        }
+        return true;
+    }
+
+    unsigned int Canvas::getEventCategory(sf::Event::EventType p_type)
+    {
+        switch (p_type)
+        {
+            case sf::Event::KeyPressed:
+            case sf::Event::KeyReleased:
+                return KeyEvents;
+            case sf::Event::TextEntered:
+                return TextEvents;
+            case sf::Event::MouseButtonPressed:
+                return PressEvents;
+            case sf::Event::MouseButtonReleased:
+                return ReleaseEvents;
+            case sf::Event::MouseWheelMoved:
+            case sf::Event::MouseWheelScrolled:
+                return WheelEvents;
+            case sf::Event::MouseMoved:
+                return MoveEvents;
+            default:
+                return OtherEvents;
+        }
+    }
+
+    int Canvas::getEventCategoryIndex(unsigned int p_category)
+    {
+        int index = 0;
+        while((1u << index) < p_category)
+        {
+            index++;
+        }
+        return index;
+    }
+    
+    void Canvas::add(Widget* p_widget) 
+    {
+        // Check if widget alreay exists.
+        if(p_widget->canvas_slot != -1) return;
+
+        // Add widget.
+        link(p_widget, p_widget->getLayer());
+        widget_count++;
+        p_widget->invalidate();
+
+        // Keep the number of removed but still linked slots in check, in case no frames are running while many widgets are created and destroyed.
+        if(removed_slots.size() > widget_count)
+        {
+            compact();
+        }
+    }
+
+    void Canvas::remove(Widget* p_widget) 
+    {
+        if(p_widget->canvas_slot == -1) return;
+
+        // The area the widget was drawn to and the caches of its masks have to be redrawn without it.
+        p_widget->invalidate();
+        if(p_widget->is_cached)
+        {
+            releaseCache(p_widget);
+            removeCached(p_widget);
+        }
+
+        removeFromHitGrid(p_widget);
+        unlink(p_widget);
+        widget_count--;
+
+        // Stop sending events to the widget, even if it is removed while an event is sent.
+        for (int i = 0; i < s_event_category_count; i++)
+        {
+            if(p_widget->subscriber_positions[i] != -1)
+            {
+                global_subscribers[i][p_widget->subscriber_positions[i]] = nullptr;
+                p_widget->subscriber_positions[i] = -1;
+            }
+        }
+        if(p_widget->event_target_position != -1)
+        {
+            event_targets[p_widget->event_target_position] = nullptr;
+            p_widget->event_target_position = -1;
+        }
+
+        // Stop updating the widget.
+        if(p_widget->update_queue_position != -1)
+        {
+            update_queue[p_widget->update_queue_position] = nullptr;
+            p_widget->update_queue_position = -1;
+        }
+        p_widget->setUpdatedEveryFrame(false);
+
+        // The measurements of removed widgets are kept in the profile of their type.
+        auto profile = widget_profiles.find(p_widget);
+        if(profile != widget_profiles.end())
+        {
+            Profile& type_profile = removed_type_profiles[profile->second.type];
+            type_profile.type = profile->second.type;
+            addProfile(type_profile, profile->second);
+            widget_profiles.erase(profile);
+        }
+        if(p_widget->scheduled_position != -1)
+        {
+            unschedule(p_widget);
+        }
+
+        if(p_widget->invalidated_position != -1)
+        {
+            invalidated_widgets[p_widget->invalidated_position] = nullptr;
+            p_widget->invalidated_position = -1;
+        }
+
+        if(selected_widget == p_widget) selected_widget = nullptr;
+        if(hovered_widget == p_widget) hovered_widget = nullptr;
+    }
+    
+    void Canvas::moveToLayer(Widget* p_widget, int p_layer)
+    {
+        if(p_widget->canvas_slot == -1) return;
+
+        // Relink the widget in a new slot, the old slot stays valid for everyone iterating over it.
+        unlink(p_widget);
+        link(p_widget, p_layer);
+        p_widget->invalidate();
+    }
+
+    int Canvas::getWidgetCount() const
+    {
+        return widget_count;
+    }
+
+    void Canvas::link(Widget* p_widget, int p_layer)
+    {
+        int index;
+        if(free_slots.size() > 0)
+        {
+            index = free_slots.back();
+            free_slots.pop_back();
+        }
+        else
+        {
+            index = slots.size();
+            slots.push_back(Slot());
+            slot_flags.push_back(0);
+            slot_bounds.push_back(sf::FloatRect());
+        }
+
+        // Append the slot to the list of the given layer, so the widget is drawn after all widgets that are already on this layer.
+        Layer& layer = layers[p_layer];
+        Slot& slot = slots[index];
+        slot.widget = p_widget;
+        slot.previous = layer.last;
+        slot.next = -1;
+        slot.layer = p_layer;
+        if(layer.last != -1)
+        {
+            slots[layer.last].next = index;
+        }
+        else
+        {
+            layer.first = index;
+        }
+        layer.last = index;
+
+        p_widget->canvas_slot = index;
+        // The widget is now the last one in its layer.
+        p_widget->layer_order = layer_order_counter++;
+        refreshSlot(p_widget);
+    }
+
+    void Canvas::unlink(Widget* p_widget)
+    {
+        slots[p_widget->canvas_slot].widget = nullptr;
+        slot_flags[p_widget->canvas_slot] = 0;
+        removed_slots.push_back(p_widget->canvas_slot);
+        p_widget->canvas_slot = -1;
+    }
+
+    void Canvas::refreshSlot(const Widget* p_widget)
+    {
+        int index = p_widget->canvas_slot;
+        if(index == -1) return;
+
+        slot_flags[index] = (p_widget->is_visible ? SlotVisible : 0) | (p_widget->is_selectable ? SlotSelectable : 0);
+
+        // A widget without overflow only draws to its clipped bounds.
+        const sf::FloatRect& clipped = p_widget->clipped_bounds;
+        const sf::FloatRect& overflow = p_widget->overflow_bounds;
+        if(overflow.width <= 0.f || overflow.height <= 0.f)
+        {
+            slot_bounds[index] = clipped;
+        }
+        else if(clipped.width <= 0.f || clipped.height <= 0.f)
+        {
+            slot_bounds[index] = overflow;
+        }
+        else
+        {
+            float left = std::min(clipped.left, overflow.left);
+            float top = std::min(clipped.top, overflow.top);
+            float right = std::max(clipped.left + clipped.width, overflow.left + overflow.width);
+            float bottom = std::max(clipped.top + clipped.height, overflow.top + overflow.height);
+            slot_bounds[index] = sf::FloatRect(left, top, right - left, bottom - top);
+        }
+    }
+
+    void Canvas::compact()
+    {
+        if(iteration_depth > 0) return;
+
+        for (int i = 0; i < removed_slots.size(); i++)
+        {
+            int index = removed_slots[i];
+            Slot& slot = slots[index];
+            auto search = layers.find(slot.layer);
+            Layer& layer = search->second;
+
+            if(slot.previous != -1)
+            {
+                slots[slot.previous].next = slot.next;
+            }
+            else
+            {
+                layer.first = slot.next;
+            }
+            if(slot.next != -1)
+            {
+                slots[slot.next].previous = slot.previous;
+            }
+            else
+            {
+                layer.last = slot.previous;
+            }
+
+            if(layer.first == -1)
+            {
+                layers.erase(search);
+            }
+            slot = Slot();
+            free_slots.push_back(index);
+        }
+        removed_slots.clear();
+
+        for (int i = 0; i < s_event_category_count; i++)
+        {
+            std::vector<Widget*>& subscribers = global_subscribers[i];
+            subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), (Widget*)nullptr), subscribers.end());
+            for (int j = 0; j < subscribers.size(); j++)
+            {
+                subscribers[j]->subscriber_positions[i] = j;
+            }
+        }
+        every_frame_widgets.erase(std::remove(every_frame_widgets.begin(), every_frame_widgets.end(), (Widget*)nullptr), every_frame_widgets.end());
+        for (int i = 0; i < every_frame_widgets.size(); i++)
+        {
+            every_frame_widgets[i]->every_frame_position = i;
+        }
+    }
+
+    Widget* Canvas::getSelected() 
+    {
+        return selected_widget;
+    }
+
+    Widget* Canvas::getHovered()
+    {
+        return hovered_widget;
+    }
+
+    Widget* Canvas::findWidgetAt(const sf::Vector2f& p_position) const
+    {
+        int column = (int)std::floor(p_position.x / s_hit_cell_size);
+        int row = (int)std::floor(p_position.y / s_hit_cell_size);
+        if(column < 0 || row < 0 || column >= hit_grid_columns || row >= hit_grid_rows) return nullptr;
+
+        // Widgets are drawn by layer and inside a layer in the order they were moved to it, so the top most widget is the one with the highest layer and layer order.
+        Widget* top_widget = nullptr;
+        const std::vector<Widget*>& cell = hit_grid[row * hit_grid_columns + column];
+        for (int i = 0; i < cell.size(); i++)
+        {
+            if(!cell[i]->clipped_bounds.contains(p_position)) continue;
+            if(top_widget == nullptr || cell[i]->layer > top_widget->layer || (cell[i]->layer == top_widget->layer && cell[i]->layer_order > top_widget->layer_order))
+            {
+                top_widget = cell[i];
+            }
+        }
+        return top_widget;
+    }
+    
+    const sf::View& Canvas::getView() const
+    {
+        return view;
+    }
+    
+    QuadBatch& Canvas::getBatch()
+    {
+        return batch;
+    }
+
+    void Canvas::setPartialRedraw(bool p_state)
+    {
+        if(partial_redraw == p_state) return;
+        partial_redraw = p_state;
+        dirty_region.clear();
+        invalidated_widgets.clear();
+
+        // Everything is measured and drawn once when partial redraws start, the old frame could show anything.
+        iteration_depth++;
+        for (auto& layer : layers)
+        {
+            for (int i = layer.second.first; i != -1; i = slots[i].next)
+            {
+                Widget* widget = slots[i].widget;
+                if(widget == nullptr) continue;
+
+                widget->invalidated_position = -1;
+                widget->invalidate();
+            }
+        }
+        iteration_depth--;
+        invalidate(getBounds());
+    }
+
+    bool Canvas::isPartialRedraw() const
+    {
+        return partial_redraw;
+    }
+
+    void Canvas::invalidate(const sf::FloatRect& p_area)
+    {
+        redraw_needed = true;
+
+        sf::FloatRect area;
+        if(!partial_redraw || !p_area.intersects(getBounds(), area)) return;
+
+        // Merge the area with all rectangles it overlaps, so no part of the dirty region is drawn twice.
+        for (int i = 0; i < dirty_region.size(); i++)
+        {
+            if(area.intersects(dirty_region[i]))
+            {
+                area = combineRectangles(area, dirty_region[i]);
+                dirty_region[i] = dirty_region.back();
+                dirty_region.pop_back();
+                // The combined area might overlap rectangles that were checked before.
+                i = -1;
+            }
+        }
+        dirty_region.push_back(area);
+
+        // Drawing a bit more is cheaper than going through the widgets for many small rectangles.
+        if(dirty_region.size() > s_max_dirty_rects)
+        {
+            for (int i = 1; i < dirty_region.size(); i++)
+            {
+                dirty_region[0] = combineRectangles(dirty_region[0], dirty_region[i]);
+            }
+            dirty_region.resize(1);
+        }
+    }
+
+    const std::vector<sf::FloatRect>& Canvas::getDirtyRegion()
+    {
+        measureInvalidated();
+        return dirty_region;
+    }
+
+    void Canvas::setCacheBudget(std::size_t p_bytes)
+    {
+        cache_budget = p_bytes;
+    }
+
+    std::size_t Canvas::getCacheBudget() const
+    {
+        return cache_budget;
+    }
+
+    std::size_t Canvas::getCacheMemory() const
+    {
+        return cache_memory;
+    }
+
+    void Canvas::collectDrawList(const sf::FloatRect& p_area, Widget* p_mask)
+    {
+        // Removed slots have no flags.
+        draw_list.clear();
+        for (auto& layer : layers)
+        {
+            for (int i = layer.second.first; i != -1; i = slots[i].next)
+            {
+                if(!(slot_flags[i] & SlotVisible) || !slot_bounds[i].intersects(p_area)) continue;
+
+                Widget* mask = slots[i].widget;
+                if(p_mask != nullptr)
+                {
+                    while(mask != nullptr && mask != p_mask) mask = mask->mask;
+                }
+                if(mask != nullptr) draw_list.push_back(i);
+            }
+        }
+    }
+
+    void Canvas::drawDrawList(Widget* p_limit)
+    {
+        // Widgets can still be removed while others are drawn.
+        iteration_depth++;
+        for (int i = 0; i < draw_list.size(); i++)
+        {
+            Widget* widget = slots[draw_list[i]].widget;
+            if(widget != nullptr)
+            {
+                drawWidget(widget, p_limit);
+            }
+        }
+        iteration_depth--;
+    }
+
+    void Canvas::drawWidget(Widget* p_widget, Widget* p_limit)
+    {
+        Widget* cache = findCache(p_widget, p_limit);
+        if(cache == nullptr)
+        {
+            profileCall(p_widget, &Profile::draw_time, &Profile::draw_count, [&]() { p_widget->draw(); });
+        }
+        else if(cache == p_widget)
+        {
+            // The colors in the cache are already multiplied with their alpha, because they were blended onto a transparent texture.
+            sf::Vector2u size = p_widget->cache_texture->getSize();
+            batch.setBlendMode(sf::BlendMode(sf::BlendMode::One, sf::BlendMode::OneMinusSrcAlpha));
+            batch.addTexturedRectangle(sf::FloatRect(p_widget->cache_area.left, p_widget->cache_area.top, size.x, size.y), sf::FloatRect(0.f, 0.f, size.x, size.y), &p_widget->cache_texture->getTexture(), sf::Color::White, getBounds());
+            batch.setBlendMode(sf::BlendAlpha);
+        }
+    }
+
+    Widget* Canvas::findCache(Widget* p_widget, Widget* p_limit) const
+    {
+        Widget* cache = nullptr;
+        for (Widget* widget = p_widget; widget != nullptr && widget != p_limit; widget = widget->mask)
+        {
+            if(widget->is_cached && widget->is_cache_valid && widget->cache_texture != nullptr && widget->cache_last_used == frame_counter)
             {
-                print();
+                cache = widget;
             }
         }
+        return cache;
+    }
 
-        // Update widget events always.
-        for (int i = 0; i < widget_list.size(); i++)
+    void Canvas::refreshCaches()
+    {
+        if(cached_widgets.size() == 0) return;
+
+        // Caches inside of other caches have to be drawn first, so the outer cache can draw them. Masks are always closer to the top.
+        std::vector<std::pair<int, Widget*>> caches;
+        for (int i = 0; i < cached_widgets.size(); i++)
+        {
+            Widget* widget = cached_widgets[i];
+            if(!widget->isVisible() || widget->canvas_slot == -1) continue;
+
+            int depth = 0;
+            for (Widget* mask = widget->mask; mask != nullptr; mask = mask->mask)
+            {
+                depth++;
+            }
+            caches.push_back(std::make_pair(depth, widget));
+            widget->cache_last_used = frame_counter;
+        }
+        std::sort(caches.begin(), caches.end(), [](const std::pair<int, Widget*>& p_first, const std::pair<int, Widget*>& p_second)
+        {
+            return p_first.first > p_second.first;
+        });
+
+        for (int i = 0; i < caches.size(); i++)
         {
-            if(widget_list[i]->isUpdated() && widget_list[i]->isVisible())
+            if(!caches[i].second->is_cache_valid)
             {
-                widget_list[i]->updateEvents(p_event);
+                renderCache(caches[i].second);
             }
         }
     }
-    
-    void Canvas::add(Widget* p_widget) 
+
+    void Canvas::renderCache(Widget* p_widget)
     {
-        // Check if widget alreay exists.
-        if(find(p_widget) != -1) return;
+        p_widget->is_cache_valid = true;
 
-        // Add widget.
-        widget_list.push_back(p_widget);
+        // Find the area all widgets of the cache are drawn to. The widgets masked to the cached widget are drawn inside of its clipped bounds, so only the widgets in its bounds are looked at.
+        collectDrawList(slot_bounds[p_widget->canvas_slot], p_widget);
+        batch.beginMeasure();
+        drawDrawList(p_widget);
+        sf::FloatRect measured_area = batch.endMeasure();
+
+        // Align the area to whole pixels, so the texture is drawn without being filtered.
+        float left = std::floor(measured_area.left);
+        float top = std::floor(measured_area.top);
+        sf::FloatRect area(left, top, std::ceil(measured_area.left + measured_area.width) - left, std::ceil(measured_area.top + measured_area.height) - top);
+
+        // The area changes the drawn area of the cached widget.
+        p_widget->invalidateDrawnArea();
+
+        sf::Vector2u size((unsigned int)area.width, (unsigned int)area.height);
+        std::size_t memory = size.x * size.y * 4;
+        if(memory == 0 || memory > cache_budget)
+        {
+            releaseCache(p_widget);
+            return;
+        }
+
+        // Release the caches used the longest time ago until the new texture fits into the budget. Textures that are not resized can be reused.
+        if(p_widget->cache_texture != nullptr && p_widget->cache_texture->getSize() != size)
+        {
+            releaseCache(p_widget);
+        }
+        std::size_t required_memory = p_widget->cache_texture == nullptr ? memory : 0;
+        while(cache_memory + required_memory > cache_budget)
+        {
+            Widget* least_recently_used = nullptr;
+            for (int i = 0; i < cached_widgets.size(); i++)
+            {
+                Widget* widget = cached_widgets[i];
+                if(widget == p_widget || widget->cache_texture == nullptr) continue;
+                if(least_recently_used == nullptr || widget->cache_last_used < least_recently_used->cache_last_used)
+                {
+                    least_recently_used = widget;
+                }
+            }
+            if(least_recently_used == nullptr) return;
+            releaseCache(least_recently_used);
+        }
+
+        if(p_widget->cache_texture == nullptr)
+        {
+            p_widget->cache_texture.reset(new sf::RenderTexture());
+            if(!p_widget->cache_texture->create(size.x, size.y))
+            {
+                std::cout << "Failed to create a cache texture!" << std::endl;
+                p_widget->cache_texture.reset();
+                return;
+            }
+            cache_memory += memory;
+        }
+        p_widget->cache_area = area;
+
+        // Draw all widgets of the cache into its texture. The view makes the window coordinates of the area fit the texture.
+        sf::RenderTexture& texture = *p_widget->cache_texture;
+        texture.setView(sf::View(sf::FloatRect(area.left, area.top, size.x, size.y)));
+        texture.clear(sf::Color::Transparent);
 
-        moveToLayer(p_widget, p_widget->getLayer());
+        sf::RenderTarget& previous_target = batch.getTarget();
+        batch.setTarget(texture);
+        drawDrawList(p_widget);
+        batch.setTarget(previous_target);
+        texture.display();
     }
 
-    int Canvas::find(Widget* p_widget) const
+    void Canvas::releaseCache(Widget* p_widget)
     {
-        for (int i = 0; i < widget_list.size(); i++)
+        if(p_widget->cache_texture == nullptr) return;
+
+        cache_memory -= p_widget->cache_texture->getSize().x * p_widget->cache_texture->getSize().y * 4;
+        p_widget->cache_texture.reset();
+        p_widget->invalidateDrawnArea();
+    }
+
+    void Canvas::measureInvalidated()
+    {
+        for (int i = 0; i < invalidated_widgets.size(); i++)
         {
-            if(widget_list[i] == p_widget)
+            Widget* widget = invalidated_widgets[i];
+            if(widget == nullptr) continue;
+
+            widget->invalidated_position = -1;
+            widget->drawn_bounds = sf::FloatRect();
+            if(widget->isVisible())
             {
-                return i;
+                // Widgets drawn with the cache of a mask are measured as well, so they are redrawn correctly if the cache is released.
+                batch.beginMeasure();
+                if(findCache(widget) == widget)
+                {
+                    drawWidget(widget);
+                }
+                else
+                {
+                    widget->draw();
+                }
+                widget->drawn_bounds = batch.endMeasure();
             }
+            invalidate(widget->drawn_bounds);
         }
-        return -1;
+        invalidated_widgets.clear();
     }
 
-    void Canvas::remove(Widget* p_widget) 
+    void Canvas::redrawDirtyRegion()
     {
-        for (int i = 0; i < widget_list.size(); i++)
+        // The frame needs to be recreated when the window was resized. Then everything has to be drawn again.
+        if(frame.getSize() != target.getSize())
         {
-            if(widget_list[i] == p_widget)
+            if(!frame.create(target.getSize().x, target.getSize().y))
             {
-                widget_list.erase(widget_list.begin() + i);
+                std::cout << "Failed to create the frame for partial redraws!" << std::endl;
+                setPartialRedraw(false);
                 return;
             }
+            invalidate(getBounds());
+        }
+
+        measureInvalidated();
+        if(dirty_region.size() == 0) return;
+
+        frame.setView(view);
+
+        // Erase the dirty region first, so widgets with transparent parts are not drawn on top of their old selves.
+        sf::VertexArray erase_vertices(sf::Triangles);
+        for (int i = 0; i < dirty_region.size(); i++)
+        {
+            const sf::FloatRect& area = dirty_region[i];
+            erase_vertices.append(sf::Vertex(sf::Vector2f(area.left, area.top), sf::Color::Transparent));
+            erase_vertices.append(sf::Vertex(sf::Vector2f(area.left + area.width, area.top), sf::Color::Transparent));
+            erase_vertices.append(sf::Vertex(sf::Vector2f(area.left, area.top + area.height), sf::Color::Transparent));
+            erase_vertices.append(sf::Vertex(sf::Vector2f(area.left + area.width, area.top), sf::Color::Transparent));
+            erase_vertices.append(sf::Vertex(sf::Vector2f(area.left + area.width, area.top + area.height), sf::Color::Transparent));
+            erase_vertices.append(sf::Vertex(sf::Vector2f(area.left, area.top + area.height), sf::Color::Transparent));
+        }
+        frame.draw(erase_vertices, sf::RenderStates(sf::BlendNone));
+
+        // Redraw all widgets that were drawn to the dirty region, each one clipped to it.
+        batch.setTarget(frame);
+        iteration_depth++;
+        for (int r = 0; r < dirty_region.size(); r++)
+        {
+            batch.setScissor(dirty_region[r]);
+            for (auto& layer : layers)
+            {
+                for (int i = layer.second.first; i != -1; i = slots[i].next)
+                {
+                    Widget* widget = slots[i].widget;
+                    if(widget == nullptr) continue;
+
+                    if(widget->isVisible() && widget->drawn_bounds.intersects(dirty_region[r]))
+                    {
+                        drawWidget(widget);
+                    }
+                }
+            }
         }
+        iteration_depth--;
+        batch.removeScissor();
+        batch.setTarget(target);
+
+        frame.display();
+        dirty_region.clear();
+    }
+
+    sf::FloatRect Canvas::getBounds() const
+    {
+        return sf::FloatRect(view.getCenter() - view.getSize() / 2.f, view.getSize());
     }
     
-    void Canvas::moveToLayer(Widget* p_widget, int p_layer)
+    void Canvas::select(Widget* p_widget)
     {
-        // First remove the given widget.
-        remove(p_widget);
-        // Insert the widget behind the last widget that has the same layer as the given one.
-        for (int i = 0; i < widget_list.size(); i++)
+        if(selected_widget == p_widget) return;
+
+        // Widgets reacting to being selected are updated when they are selected or deselected.
+        requestUpdates(selected_widget);
+        selected_widget = p_widget;
+        requestUpdates(selected_widget);
+    }
+
+    InputSource& Canvas::getInput()
+    {
+        return *input;
+    }
+
+    sf::Vector2f Canvas::getMousePosition() const
+    {
+        return target.mapPixelToCoords(input->getMousePosition(), view);
+    }
+
+    bool Canvas::needsRedraw() const
+    {
+        return redraw_needed || update_queue.size() > 0 || every_frame_widgets.size() > 0;
+    }
+
+    sf::Time Canvas::getTimeUntilUpdate() const
+    {
+        if(needsRedraw()) return sf::Time::Zero;
+        if(scheduled_widgets.size() == 0) return sf::seconds(-1.f);
+
+        float next_update_time = scheduled_widgets[0]->scheduled_update_time;
+        return sf::seconds(std::max(next_update_time - timer_clock.getElapsedTime().asSeconds(), 0.f));
+    }
+
+    void Canvas::run(const std::function<void(sf::Event&)>& p_on_event, const sf::Color& p_clear_color)
+    {
+        if(window == nullptr)
+        {
+            std::cout << "Canvas: run() needs a canvas that draws to a window!" << std::endl;
+            return;
+        }
+
+        while(window->isOpen())
         {
-            if(p_layer < widget_list[i]->getLayer())
+            // All events that arrived while waiting are handled before the next frame, so input is answered in the frame right after it.
+            sf::Event event;
+            if(waitEvent(event, getTimeUntilUpdate()))
             {
-                widget_list.insert(widget_list.begin() + i, p_widget);
-                return;
+                do
+                {
+                    if(p_on_event) p_on_event(event);
+                    if(event.type == sf::Event::Closed) window->close();
+
+                    updateAllEvents(event);
+                }
+                while(window->pollEvent(event));
+            }
+            if(!window->isOpen()) return;
+
+            updateAllLogic();
+            if(needsRedraw())
+            {
+                window->clear(p_clear_color);
+                drawAll();
+                window->display();
             }
         }
-        // If the layer is too high/not present, just insert at the end.
-        widget_list.insert(widget_list.begin() + widget_list.size(), p_widget);
     }
 
-    Widget* Canvas::getSelected() 
+    float Canvas::Profile::getTotalTime() const
     {
-        return selected_widget;
+        return draw_time + logic_time + event_time;
     }
 
-    Widget* Canvas::getHovered()
+    void Canvas::setProfiling(bool p_state)
     {
-        return hovered_widget;
+        profiling = p_state;
     }
-    
-    const sf::View& Canvas::getView() const
+
+    bool Canvas::isProfiling() const
     {
-        return view;
+        return profiling;
     }
-    
-    void Canvas::select(Widget* p_widget)
+
+    void Canvas::resetProfile()
     {
-        selected_widget = p_widget;
+        widget_profiles.clear();
+        removed_type_profiles.clear();
+        profiled_frames = 0;
     }
 
-    void Canvas::print()
+    int Canvas::getProfiledFrames() const
     {
-        std::cout << "Canvas (" << this << ")" << std::endl;
-        for (int i = 0; i < widget_list.size(); i++)
+        return profiled_frames;
+    }
+
+    std::vector<Canvas::Profile> Canvas::getWidgetProfiles(std::size_t p_count) const
+    {
+        std::vector<Profile> profiles;
+        profiles.reserve(widget_profiles.size());
+        for (auto& profile : widget_profiles)
+        {
+            profiles.push_back(profile.second);
+        }
+        return sortProfiles(profiles, p_count);
+    }
+
+    std::vector<Canvas::Profile> Canvas::getTypeProfiles(std::size_t p_count) const
+    {
+        std::map<std::string, Profile> type_profiles = removed_type_profiles;
+        for (auto& profile : widget_profiles)
+        {
+            Profile& type_profile = type_profiles[profile.second.type];
+            type_profile.type = profile.second.type;
+            addProfile(type_profile, profile.second);
+        }
+
+        std::vector<Profile> profiles;
+        for (auto& profile : type_profiles)
+        {
+            profiles.push_back(profile.second);
+        }
+        return sortProfiles(profiles, p_count);
+    }
+
+    void Canvas::printProfile(std::size_t p_count) const
+    {
+        // Times are shown per frame.
+        float frames = std::max(profiled_frames, 1);
+        auto printProfiles = [&](const std::vector<Profile>& p_profiles)
+        {
+            for (int i = 0; i < p_profiles.size(); i++)
+            {
+                const Profile& profile = p_profiles[i];
+                std::cout << i << ".\t" << profile.type;
+                if(profile.widget != nullptr) std::cout << " (" << profile.widget << ")";
+                std::cout << "\tTotal: " << profile.getTotalTime() / frames << " ms, Draw: " << profile.draw_time / frames << " ms, Logic: " << profile.logic_time / frames 
+                    << " ms, Events: " << profile.event_time / frames << " ms, Geometry rebuilds: " << profile.geometry_rebuilds << ", View refreshes: " << profile.view_refreshes << std::endl;
+            }
+        };
+
+        std::cout << "Canvas (" << this << ") profile of " << profiled_frames << " frames" << std::endl;
+        std::cout << "Types:" << std::endl;
+        printProfiles(getTypeProfiles(p_count));
+        std::cout << "Widgets:" << std::endl;
+        printProfiles(getWidgetProfiles(p_count));
+    }
+
+    Canvas::Profile& Canvas::getProfile(const Widget* p_widget)
+    {
+        Profile& profile = widget_profiles[p_widget];
+        if(profile.widget == nullptr)
+        {
+            profile.widget = p_widget;
+            profile.type = p_widget->getTypeName();
+        }
+        return profile;
+    }
+
+    void Canvas::addProfile(Profile& p_profile, const Profile& p_other)
+    {
+        p_profile.draw_time += p_other.draw_time;
+        p_profile.logic_time += p_other.logic_time;
+        p_profile.event_time += p_other.event_time;
+        p_profile.draw_count += p_other.draw_count;
+        p_profile.logic_count += p_other.logic_count;
+        p_profile.event_count += p_other.event_count;
+        p_profile.geometry_rebuilds += p_other.geometry_rebuilds;
+        p_profile.view_refreshes += p_other.view_refreshes;
+    }
+
+    std::vector<Canvas::Profile> Canvas::sortProfiles(std::vector<Profile>& p_profiles, std::size_t p_count)
+    {
+        p_count = std::min(p_count, p_profiles.size());
+        std::partial_sort(p_profiles.begin(), p_profiles.begin() + p_count, p_profiles.end(), [](const Profile& p_first, const Profile& p_second)
+        {
+            return p_first.getTotalTime() > p_second.getTotalTime();
+        });
+        p_profiles.resize(p_count);
+        return p_profiles;
+    }
+
+    void Canvas::refreshHitGrid(Widget* p_widget)
+    {
+        // Find the cells the widget should be registered in.
+        sf::IntRect cells;
+        const sf::FloatRect& bounds = p_widget->clipped_bounds;
+        if(p_widget->is_visible && p_widget->is_selectable && bounds.width > 0.f && bounds.height > 0.f)
         {
-            sf::String type = "Widget";
-            TextField* text_field = dynamic_cast<TextField*>(widget_list[i]);
-            Button* button = dynamic_cast<Button*>(widget_list[i]);
-            ScrollList* scrolllist = dynamic_cast<ScrollList*>(widget_list[i]);
-            DropDownList* dropdownlist = dynamic_cast<DropDownList*>(widget_list[i]);
-            InputField* inputfield = dynamic_cast<InputField*>(widget_list[i]);
-            ScrollBar* scrollbar = dynamic_cast<ScrollBar*>(widget_list[i]);
-            LayoutGroup* layoutgroup = dynamic_cast<LayoutGroup*>(widget_list[i]);
-            if(text_field != nullptr) type = "TextField (Content: " + text_field->getString() + ")";
-            if(button != nullptr) type = "Button";
-            if(scrolllist != nullptr) type = "ScrollList";
-            if(inputfield != nullptr) type = "InputField";
-            if(scrollbar != nullptr) type = "ScrollBar";
-            if(layoutgroup != nullptr) type = "LayoutGroup";
+            int left = std::max((int)std::floor(bounds.left / s_hit_cell_size), 0);
+            int top = std::max((int)std::floor(bounds.top / s_hit_cell_size), 0);
+            int right = std::min((int)std::floor((bounds.left + bounds.width) / s_hit_cell_size), hit_grid_columns - 1);
+            int bottom = std::min((int)std::floor((bounds.top + bounds.height) / s_hit_cell_size), hit_grid_rows - 1);
+            if(left <= right && top <= bottom)
+            {
+                cells = sf::IntRect(left, top, right - left + 1, bottom - top + 1);
+            }
+        }
+
+        // Most of the time a widget moves inside the same cells, then nothing has to be done.
+        if(cells == p_widget->hit_cells) return;
+
+        removeFromHitGrid(p_widget);
+        for (int row = cells.top; row < cells.top + cells.height; row++)
+        {
+            for (int column = cells.left; column < cells.left + cells.width; column++)
+            {
+                hit_grid[row * hit_grid_columns + column].push_back(p_widget);
+            }
+        }
+        p_widget->hit_cells = cells;
+    }
+
+    void Canvas::removeFromHitGrid(Widget* p_widget)
+    {
+        const sf::IntRect& cells = p_widget->hit_cells;
+        for (int row = cells.top; row < cells.top + cells.height; row++)
+        {
+            for (int column = cells.left; column < cells.left + cells.width; column++)
+            {
+                // Search from the back, since widgets are mostly moved right after they were registered.
+                std::vector<Widget*>& cell = hit_grid[row * hit_grid_columns + column];
+                for (int i = (int)cell.size() - 1; i >= 0; i--)
+                {
+                    if(cell[i] == p_widget)
+                    {
+                        // The order inside a cell does not matter.
+                        cell[i] = cell.back();
+                        cell.pop_back();
+                        break;
+                    }
+                }
+            }
+        }
+        p_widget->hit_cells = sf::IntRect();
+    }
+
+    void Canvas::resetHitGrid()
+    {
+        hit_grid_columns = target.getSize().x / s_hit_cell_size + 1;
+        hit_grid_rows = target.getSize().y / s_hit_cell_size + 1;
+        hit_grid.clear();
+        hit_grid.resize(hit_grid_columns * hit_grid_rows);
+        for (auto& layer : layers)
+        {
+            for (int i = layer.second.first; i != -1; i = slots[i].next)
+            {
+                Widget* widget = slots[i].widget;
+                if(widget == nullptr) continue;
 
-            std::cout << i << ".\t" << &widget_list[i] << " (Layer: " << widget_list[i]->getLayer() << ", Selected: " << (selected_widget == widget_list[i]) << ", Hovered: " << (hovered_widget == widget_list[i]) << ") Type: " << type.toAnsiString() << std::endl;
+                widget->hit_cells = sf::IntRect();
+            }
         }
     }
 
@@ -2411,16 +5227,174 @@ namespace jui
     }
 
     ResourceHandler<std::string, sf::Font> Fonts::s_fontTable;
+    std::map<std::string, std::shared_future<bool>> Fonts::s_loading;
+    std::mutex Fonts::s_mutex;
+    std::map<std::pair<const sf::Font*, unsigned int>, Fonts::Atlas> Fonts::s_atlases;
+
+    float Fonts::AtlasStatistics::getFill() const
+    {
+        if(texture_size.x == 0 || texture_size.y == 0) return 0.f;
+        return (float)glyph_area / ((float)texture_size.x * texture_size.y);
+    }
 
     bool Fonts::load(const std::string& p_name, const std::string& p_filePath)
     {
+        std::lock_guard<std::mutex> lock(s_mutex);
         return s_fontTable.load(p_name, p_filePath);
     }
+
+    std::shared_future<bool> Fonts::loadAsync(const std::string& p_name, const std::string& p_filePath)
+    {
+        std::shared_future<bool> loading = std::async(std::launch::async, [p_name, p_filePath]()
+        {
+            // Reading the file only touches the new font, so only adding it to the table needs the lock.
+            sf::Font* font = new sf::Font();
+            if(!font->loadFromFile(p_filePath))
+            {
+                sf::String temp(p_filePath);
+                std::wcerr << L"Fonts: Failed to load " << temp.toWideString() << std::endl;
+                delete font;
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(s_mutex);
+            return s_fontTable.add(p_name, font);
+        }).share();
+
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_loading[p_name] = loading;
+        return loading;
+    }
+
     sf::Font& Fonts::get(const std::string& p_name)
     {
+        std::unique_lock<std::mutex> lock(s_mutex);
+        auto loading = s_loading.find(p_name);
+        if(loading != s_loading.end())
+        {
+            // The loading thread needs the lock to finish.
+            std::shared_future<bool> future = loading->second;
+            lock.unlock();
+            future.wait();
+            lock.lock();
+            s_loading.erase(p_name);
+        }
         return s_fontTable.get(p_name);
     }
 
+    void Fonts::prewarm(const sf::Font& p_font, const std::vector<unsigned int>& p_sizes, const std::vector<GlyphRange>& p_ranges)
+    {
+        for (unsigned int size : p_sizes)
+        {
+            for (const GlyphRange& range : p_ranges)
+            {
+                for (sf::Uint32 code_point = range.first; code_point <= range.last; code_point++)
+                {
+                    loadGlyph(p_font, code_point, size, false);
+                }
+            }
+        }
+    }
+
+    const sf::Glyph& Fonts::getGlyph(const sf::Font& p_font, sf::Uint32 p_code_point, unsigned int p_character_size)
+    {
+        return loadGlyph(p_font, p_code_point, p_character_size, true);
+    }
+
+    std::vector<Fonts::AtlasStatistics> Fonts::getAtlasStatistics(const sf::Font& p_font)
+    {
+        std::vector<AtlasStatistics> statistics;
+        for (auto it = s_atlases.lower_bound(std::make_pair(&p_font, 0u)); it != s_atlases.end() && it->first.first == &p_font; it++)
+        {
+            statistics.push_back(it->second.statistics);
+            // The texture grows when glyphs are added, also by others than Fonts.
+            statistics.back().texture_size = p_font.getTexture(it->first.second).getSize();
+        }
+        return statistics;
+    }
+
+    void Fonts::reloadGlyphTables(const sf::Font& p_font)
+    {
+        for (auto it = s_atlases.lower_bound(std::make_pair(&p_font, 0u)); it != s_atlases.end() && it->first.first == &p_font; it++)
+        {
+            // Forgetting the texture size makes the table read all its glyphs again.
+            it->second.glyphs.texture_size = sf::Vector2u();
+            refreshGlyphTable(p_font, it->first.second, it->second.glyphs);
+        }
+    }
+
+    void Fonts::resetMisses()
+    {
+        for (auto& atlas : s_atlases)
+        {
+            atlas.second.statistics.misses = 0;
+        }
+    }
+
+    const GlyphTable& Fonts::getGlyphTable(const sf::Font& p_font, unsigned int p_character_size)
+    {
+        Atlas& atlas = s_atlases[std::make_pair(&p_font, p_character_size)];
+        atlas.statistics.character_size = p_character_size;
+        // Others than Fonts can add glyphs to the atlas as well.
+        refreshGlyphTable(p_font, p_character_size, atlas.glyphs);
+        return atlas.glyphs;
+    }
+
+    const sf::Glyph& Fonts::loadGlyph(const sf::Font& p_font, sf::Uint32 p_code_point, unsigned int p_character_size, bool p_count_miss)
+    {
+        Atlas& atlas = s_atlases[std::make_pair(&p_font, p_character_size)];
+        const sf::Glyph* known_glyph = atlas.glyphs.find(p_code_point);
+        if(known_glyph != nullptr) return *known_glyph;
+
+        const sf::Glyph& glyph = p_font.getGlyph(p_code_point, p_character_size, false);
+        atlas.statistics.character_size = p_character_size;
+        atlas.statistics.glyph_count++;
+        // Glyphs without pixels, like spaces, do not take up space in the atlas.
+        if(glyph.textureRect.width > 0 && glyph.textureRect.height > 0)
+        {
+            atlas.statistics.glyph_area += (glyph.textureRect.width + 2 * s_glyph_padding) * (glyph.textureRect.height + 2 * s_glyph_padding);
+        }
+        if(p_count_miss) atlas.statistics.misses++;
+
+        sf::Glyph* stored_glyph = nullptr;
+        if(p_code_point < 256)
+        {
+            atlas.glyphs.latin1[p_code_point] = glyph;
+            atlas.glyphs.latin1_loaded[p_code_point] = true;
+            stored_glyph = &atlas.glyphs.latin1[p_code_point];
+        }
+        else
+        {
+            stored_glyph = &(atlas.glyphs.others[p_code_point] = glyph);
+        }
+        // Rasterizing the glyph can grow the atlas texture.
+        refreshGlyphTable(p_font, p_character_size, atlas.glyphs);
+        return *stored_glyph;
+    }
+
+    void Fonts::refreshGlyphTable(const sf::Font& p_font, unsigned int p_character_size, GlyphTable& p_table)
+    {
+        // SFML copies the glyphs when the atlas texture grows, so their texture rects usually stay the same. Reading them again keeps the table right if they moved anyway.
+        sf::Vector2u texture_size = p_font.getTexture(p_character_size).getSize();
+        if(texture_size == p_table.texture_size) return;
+        p_table.texture_size = texture_size;
+
+        for (sf::Uint32 code_point = 0; code_point < 256; code_point++)
+        {
+            if(p_table.latin1_loaded[code_point]) p_table.latin1[code_point] = p_font.getGlyph(code_point, p_character_size, false);
+        }
+        for (auto& glyph : p_table.others)
+        {
+            glyph.second = p_font.getGlyph(glyph.first, p_character_size, false);
+        }
+    }
+
+    const sf::Glyph* GlyphTable::find(sf::Uint32 p_code_point) const
+    {
+        if(p_code_point < 256) return latin1_loaded[p_code_point] ? &latin1[p_code_point] : nullptr;
+        auto it = others.find(p_code_point);
+        return it == others.end() ? nullptr : &it->second;
+    }
+
     Cursor::CursorData::CursorData()
     {
         for (int i = 0; i < 13; i++)
@@ -2490,6 +5464,18 @@ namespace jui
         return rectangle.contains(mousePosition);
     }
 
+    sf::FloatRect combineRectangles(const sf::FloatRect& p_first, const sf::FloatRect& p_second)
+    {
+        if(p_first.width <= 0.f || p_first.height <= 0.f) return p_second;
+        if(p_second.width <= 0.f || p_second.height <= 0.f) return p_first;
+
+        float left = std::min(p_first.left, p_second.left);
+        float top = std::min(p_first.top, p_second.top);
+        float right = std::max(p_first.left + p_first.width, p_second.left + p_second.width);
+        float bottom = std::max(p_first.top + p_first.height, p_second.top + p_second.height);
+        return sf::FloatRect(left, top, right - left, bottom - top);
+    }
+
     std::vector<sf::String> splitStringByChar(const sf::String& str, const wchar_t& c)
     {
         std::wstringstream strstream;
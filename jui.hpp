@@ -1,21 +1,50 @@
 #pragma once
 #include <SFML/Graphics.hpp>
 #include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <limits>
 #include <iostream> /* debugging */
 #include <sstream>
 
 namespace jui
 {
     class Canvas;
+    class LayoutGroup;
+    struct GlyphTable;
 
     enum AnchorPoint { TopLeft, Top, TopRight, Left, Middle, Right, BottomLeft, Bottom, BottomRight };
     enum Orientation { Horizontal, Vertical };
+    // How a LayoutGroup arranges its widgets, see LayoutGroup::setLayout().
+    enum LayoutType { ManualLayout, StackLayout, WrapLayout, GridLayout, FlexLayout };
+    // Categories of SFML events widgets can subscribe to, see Widget::setEventSubscription().
+    enum EventCategory
+    {
+        NoEvents                = 0,
+        KeyEvents               = 1 << 0,
+        TextEvents              = 1 << 1,
+        PressEvents             = 1 << 2,
+        ReleaseEvents           = 1 << 3,
+        WheelEvents             = 1 << 4,
+        MoveEvents              = 1 << 5,
+        OtherEvents             = 1 << 6,
+        AllEvents               = (1 << 7) - 1
+    };
 
     /*
     Widgets define a space in which UI elements can be drawn. Everything that is a UI element derives from this class. Overridden functions should call the base class implementation.
     */
     class Widget
     {
+        friend class Canvas;
+        friend class LayoutGroup;
     private:
         sf::Vector2f position;
         sf::Vector2f size;
@@ -27,29 +56,111 @@ namespace jui
         int layer = 0;
 
         Widget* mask = nullptr;
+        // The widgets this widget is the mask of. Together with 'mask' this forms the mask tree the canvas propagates clipping through, see Canvas::refreshClipping().
+        std::vector<Widget*> masked_widgets;
         std::vector<Widget*> children;
+        // The LayoutGroup the widget was added to, which is told when the widget is moved or resized.
+        LayoutGroup* group = nullptr;
+        // The size the widget asks for in a LayoutGroup with a layout, and the sizes it can be stretched or shrunk to. Negative components of the preferred size are not set.
+        sf::Vector2f preferred_size = sf::Vector2f(-1.f, -1.f);
+        sf::Vector2f min_size;
+        sf::Vector2f max_size = sf::Vector2f(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+        float flex_grow = 0.f;
+        // The anchor, see setAnchor(), and the distances of the top left and bottom right corner of the widget to their anchored points.
+        sf::FloatRect anchor;
+        sf::Vector2f anchor_offset;
+        sf::Vector2f anchor_end_offset;
+        // Position in the canvas' list of anchored widgets. -1 if the widget is not anchored.
+        int anchored_position = -1;
+
+        // The part of the widget that is not clipped by its masks in window coordinates. Cached by clipToMask(), so drawing and hit testing never have to walk the masks.
+        sf::FloatRect clipped_bounds;
+        // The area outside of its own bounds the widget draws to, see setOverflowBounds().
+        mutable sf::FloatRect overflow_bounds;
+        // The cells of the canvas' hit grid this widget is registered in. A width of 0 means the widget is not registered.
+        sf::IntRect hit_cells;
+        // Increases every time the widget is moved to a layer. Used to find the top most widget between widgets of the same layer.
+        unsigned int layer_order = 0;
+
+        // Index of the slot that links this widget into the canvas' list of its layer. -1 if the widget is not added to the canvas.
+        int canvas_slot = -1;
+
+        // The area the widget's quads covered when it was measured the last time. Only kept up to date while the canvas redraws partially.
+        sf::FloatRect drawn_bounds;
+        // Position in the canvas' list of widgets to measure before the next partial redraw. -1 if the widget is not in it, so it is added only once however often it changes.
+        int invalidated_position = -1;
+
+        // Position in the canvas' queue of widgets to update, and in its list of widgets updated every frame. -1 if the widget is not in it.
+        int update_queue_position = -1;
+        int every_frame_position = -1;
+        // The time of the canvas' timer clock in seconds the widget scheduled its next update for. Negative if it did not schedule one.
+        float scheduled_update_time = -1.f;
+        // Position in the canvas' heap of widgets that scheduled an update. -1 if the widget did not schedule one.
+        int scheduled_position = -1;
+
+        // The event categories the widget receives when they are meant for it, and the ones it always receives.
+        unsigned int routed_events = NoEvents;
+        unsigned int global_events = NoEvents;
+        // Position in the canvas' list of widgets receiving all events of each category, and in its list of widgets the current event is sent to. -1 if the widget is not in it.
+        int subscriber_positions[7] = { -1, -1, -1, -1, -1, -1, -1 };
+        int event_target_position = -1;
+
+        // A cached widget draws itself and all widgets masked to it into its cache texture, which is drawn instead of them until one of them changes.
+        bool is_cached = false;
+        // Position in the canvas' list of cached widgets. -1 if the widget is not cached.
+        int cached_position = -1;
+        bool is_cache_valid = false;
+        std::unique_ptr<sf::RenderTexture> cache_texture;
+        // The area of the window shown by the cache texture.
+        sf::FloatRect cache_area;
+        // The last frame the cache was used in. The caches used the longest time ago are released first, when the canvas runs out of its cache budget.
+        unsigned int cache_last_used = 0;
     protected:
         sf::RectangleShape background;
 
+        // Count a rebuild of the widget's geometry in the profile of the canvas, see Canvas::setProfiling().
+        void profileGeometryRebuild() const;
+        // Tell the canvas about the area outside of its own bounds the widget draws to, in window coordinates, like the text overflowing a TextField. The canvas does not draw widgets whose clipped bounds and overflow bounds are outside of the window or empty.
+        void setOverflowBounds(const sf::FloatRect& p_bounds) const;
+
         sf::View view;
-        sf::RenderWindow& window;
+        // The render target of the canvas.
+        sf::RenderTarget& target;
         Canvas& canvas;
     public:
         Widget(Canvas& p_canvas);
         virtual ~Widget();
 
+        // Get the name of the widget's class, e.g. to group the widgets in the profile of the canvas.
+        virtual const char* getTypeName() const;
+
         void move(const sf::Vector2f& p_offset);
         virtual void setPosition(const sf::Vector2f& p_position);
         virtual void setSize(const sf::Vector2f& p_size);
         virtual sf::Vector2f getPosition() const;
         virtual sf::Vector2f getSize() const;
 
-        // Methode for drawing. You can never be sure which view your drawing on when entering this function (call "window.setView(view);" for the widget's own view, but in general it is better to only use widgets and then use setMask(), instead of overriding this function).
+        // Methode for drawing. Add quads to canvas.getBatch() clipped to getClippedBounds(), or to the mask's clipped bounds for parts outside of the widget's own bounds, which need to be announced with setOverflowBounds(). If you draw to the window directly, call canvas.getBatch().flush() first, so everything added before is drawn below it (but in general it is better to only use widgets and then use setMask(), instead of overriding this function). Drawing to the window directly does not work with partial redraws.
         virtual void draw() const;
-        // Methode for updating the logic of the widget. The canvas will call this methode always.
+        // Tell the canvas that the widget looks different, so the next partial redraw draws the area it covered before and the area it covers now, and the caches of the widget and its masks are drawn again. The setters of all widgets already do this.
+        void invalidate();
+        // Methode for updating the logic of the widget. The canvas calls this methode once after requestUpdate() was called, which happens when the widget is created, receives an event, or when the hovered or selected widget changes to or from it or a widget masked to it.
         virtual void updateLogic();
-        // Methode for receiving and handling SFML events.
+        // Let the canvas call updateLogic() once in the next frame.
+        void requestUpdate();
+        // Let the canvas call updateLogic() once after the given time in seconds, e.g. to make something blink without updating it every frame. If the widget already scheduled an earlier update, that one is kept.
+        void scheduleUpdate(float p_delay);
+        // Let the canvas call updateLogic() every frame, e.g. while the widget is animated. Canvas::needsRedraw() is true as long as any widget is updated every frame.
+        void setUpdatedEveryFrame(bool p_state);
+        bool isUpdatedEveryFrame() const;
+        // Methode for receiving and handling SFML events. Only called with events of the categories the widget subscribed to with setEventSubscription().
         virtual void updateEvents(sf::Event& p_event);
+        /*
+        Choose which events are passed to updateEvents(). Both parameters are combinations of EventCategory flags.
+        @param p_routed Receive events of these categories when they are meant for this widget or a widget masked to it. Key, text, press and release events are meant for the selected widget, wheel and move events for the hovered widget. Other events are meant for all widgets.
+        @param p_global Receive all events of these categories, no matter which widget they are meant for.
+        */
+        void setEventSubscription(unsigned int p_routed, unsigned int p_global = NoEvents);
 
         // Whether updatedLogic() and updateEvents() and draw() should be called by the canvas.
         virtual void setVisible(bool p_state);
@@ -62,9 +173,9 @@ namespace jui
         bool isSelectable();
         /* 
         Set another widget to the mask of this widget. All widgets follow following three rules:
-        1. A widget should be drawn to the view of its mask. Therefore parts of the widget outside of the mask will be clipped.
+        1. A widget should be drawn to the clipped bounds of its mask. Therefore parts of the widget outside of the mask will be clipped.
         2. A widget should only be selectable if the mouse is over the mask's bounds.
-        3. A child that is outside of its mask needs to resize its own view, so that the view is kept inside the mask's bounds. This applies the clipping of outer masks to this widget.
+        3. A child that is outside of its mask needs to shrink its own clipped bounds, so that they are kept inside the mask's clipped bounds. This applies the clipping of outer masks to this widget.
         */
         virtual void setMask(Widget* p_mask);
         Widget* getMask() const;
@@ -77,10 +188,16 @@ namespace jui
         Widget* getChild(int p_index);
         int getChildCount();
 
-        // Check if the mouse is over this widget.
+        // Check if the mouse is over the part of this widget that is not clipped by its masks.
         bool mouseOver();
 
+        // Draw this widget and all widgets masked to it into a texture once, and only draw the texture afterwards until one of them changes. Useful for big panels that rarely change, e.g. a ScrollList full of buttons. The memory all caches use is limited by Canvas::setCacheBudget().
+        void setCached(bool p_state);
+        bool isCached() const;
+
         const sf::View& getView() const;
+        // The part of the widget that is not clipped by its masks in window coordinates.
+        const sf::FloatRect& getClippedBounds() const;
 
         // LAYOUTS AND DESIGN.
 
@@ -93,11 +210,41 @@ namespace jui
         void setTexture(const sf::Texture* p_texture, const sf::IntRect& p_texture_rect);     
         void setTexture(const sf::Texture* p_texture);
 
+        /*
+        Keep the widget at a place relative to the size of the canvas, e.g. in a corner of the window while it is resized. The corners of the anchor are fractions of the canvas' size: the top left corner of the widget follows the top left corner of the anchor, the bottom right corner of the widget the bottom right corner of the anchor.
+        E.g. (1, 0, 0, 0) keeps the widget at the top right corner of the canvas, (0, 1, 1, 0) stretches it along the bottom of the canvas. The widget keeps the distances to these points it has when the anchor is set, or when it is moved or resized afterwards. Anchor only the outermost widgets, LayoutGroups move their widgets themselves.
+        */
         void setAnchor(const sf::FloatRect& p_anchor);
         const sf::FloatRect& getAnchor();
+
+        // The sizes a LayoutGroup with a layout gives the widget, see LayoutGroup::setLayout(). A widget without a preferred size gets the size it had when it was added to the group.
+        void setPreferredSize(const sf::Vector2f& p_size);
+        const sf::Vector2f& getPreferredSize() const;
+        void setMinSize(const sf::Vector2f& p_size);
+        const sf::Vector2f& getMinSize() const;
+        void setMaxSize(const sf::Vector2f& p_size);
+        const sf::Vector2f& getMaxSize() const;
+        // The share of the free space of a FlexLayout the widget is stretched by, relative to the other widgets. 0 keeps the preferred size.
+        void setFlexGrow(float p_factor);
+        float getFlexGrow() const;
+        // The size the widget asks for in a layout, within its min and max size.
+        virtual sf::Vector2f measure();
+        // Tell the LayoutGroups around the widget that its measured size changed, so they measure and arrange their widgets again before the next frame. Only the groups between the widget and the outermost group with a layout are measured again, the setters above already call this.
+        virtual void invalidateLayout();
+    protected:
+        // Keep a size within the min and max size of the widget.
+        sf::Vector2f clampSize(const sf::Vector2f& p_size) const;
     private:
-        // Changing the widget's view depending on the 'position' and 'size' class members, while making sure the view will not exceed the parent's bounds.
+        // Refresh the clipping of this widget and of all widgets masked to it that are affected by the change.
         void refreshView();
+        // Changing the widget's view and clipped bounds depending on the 'position' and 'size' class members, while making sure they will not exceed the mask's clipped bounds. Returns whether the clipped bounds changed.
+        bool clipToMask();
+        // Add the area the widget was drawn to in the last frame to the dirty region, and measure the widget again before the next partial redraw.
+        void invalidateDrawnArea();
+        // Remember the distances of the widget to its anchored points.
+        void refreshAnchorOffsets();
+        // Move and resize the widget to its anchored points in a canvas of the given size. Nothing happens if the widget is already there.
+        void applyAnchor(const sf::Vector2f& p_canvas_size);
     };
 
     class Graphic : public Widget
@@ -107,6 +254,8 @@ namespace jui
     public:
         Graphic(Canvas& p_canvas);
 
+        const char* getTypeName() const override;
+
         void setPreserveAspect(bool p_state);
         bool isPreservingAspect();
 
@@ -116,6 +265,7 @@ namespace jui
 
     class TextField : public Widget
     {
+        friend class Canvas;
     public:
         enum Alignment
         {
@@ -137,32 +287,80 @@ namespace jui
         OverflowType overflow_type;
         bool wrapping;
 
-        // Stores each line in a vector that stores the position for each character.
-        struct CharacterInfo
+        // How far the glyphs of a line reach to the right and down, and whether its first character was wrapped because it did not fit into the line before. Lines that are not wrapped can be laid out again on their own.
+        struct LineInfo
+        {
+            float right = std::numeric_limits<float>::lowest();
+            float bottom = std::numeric_limits<float>::lowest();
+            bool wrapped = false;
+        };
+        // Everything the layout computes: the lines, the vertices of the glyphs and of the selection, and where the string starts and ends. The arrays keep their capacity when the text is laid out again.
+        struct Geometry
+        {
+            // The position of every character on the baseline, line after line. The glyph of character i is made up of the vertices 6 * i to 6 * i + 5.
+            std::vector<sf::Vector2f> character_positions;
+            // The index of the first character of every line, followed by the number of characters. Line i holds the characters from line_starts[i] to line_starts[i + 1].
+            std::vector<int> line_starts;
+            std::vector<LineInfo> line_info;
+            sf::FloatRect text_bounds;
+            // How far the vertical alignment moved the lines down.
+            float vertical_offset = 0.f;
+            sf::VertexArray vertices = sf::VertexArray(sf::Triangles);
+            sf::VertexArray selection_vertices = sf::VertexArray(sf::Triangles);
+            sf::Vector2f start_of_string;
+            sf::Vector2f end_of_string;
+            // The bounds of all glyph and selection quads.
+            sf::FloatRect quad_bounds;
+        };
+        // A copy of everything the layout depends on. sf::Font is not thread-safe and rasterizes glyphs the first time they are asked for, so the metrics of all glyphs are looked up on the main thread. The layout itself only uses this copy and can be computed on any thread.
+        struct Layout
         {
-            // Position on the baseline of the text.
-            sf::Vector2f position; 
-            // Index of the first and last vertex of the 6 vertices making up the glyph.
-            int start_vertex = 0, end_vertex = 0;
+            sf::String string;
+            unsigned int character_size;
+            float line_spacing;
+            float paragraph_spacing;
+            sf::Vector2f size;
+            sf::Color text_color;
+            sf::Color selection_color;
+            Alignment horizontal_alignment;
+            Alignment vertical_alignment;
+            OverflowType overflow_type;
+            bool wrapping;
+            int start_selection;
+            int end_selection;
+            // Whether more than the string changed. Otherwise only the lines around the characters between the unchanged start and end of the string are laid out again.
+            bool whole_text;
+            int unchanged_prefix;
+            int unchanged_suffix;
+            // The glyphs of the font, which only change on the main thread before the layout is computed.
+            const GlyphTable* glyphs;
+            const sf::Font* font;
+
+            const sf::Glyph& getGlyph(sf::Uint32 p_char) const;
         };
-        mutable std::vector<std::vector<CharacterInfo>> text_info;
-        mutable sf::FloatRect text_bounds;
+        mutable Geometry geometry;
         sf::Vector2f character_bounds;
         sf::Transform text_transform;
-        mutable sf::VertexArray vertices;
         mutable bool geometry_need_update;
-
-        mutable sf::Vector2f start_of_string;
-        mutable sf::Vector2f end_of_string;
+        // Position in the canvas' list of text fields waiting to be laid out, or -1.
+        mutable int pending_layout_position = -1;
+        // The number of characters at the start and the end of the string that did not change since the last layout.
+        mutable int unchanged_prefix = 0, unchanged_suffix = 0;
+        mutable bool whole_text_changed = true;
 
         // Selection of a specific part of the text.
         int start_selection = 0, end_selection = 0;
         sf::Color selection_color;
-        mutable sf::VertexArray selection_vertices;
     public:
         TextField(Canvas& p_canvas, sf::Font& p_font);
+        ~TextField();
+
+        const char* getTypeName() const override;
 
+        // Only the lines around the characters that changed are laid out again.
         void setString(const sf::String& p_string);
+        void insert(int p_index, const sf::String& p_string);
+        void erase(int p_index, int p_count = 1);
         void setFont(const sf::Font& p_font);
         void setCharacterSize(unsigned int p_size);
         void setLineSpacing(float p_spacing_factor);
@@ -193,15 +391,30 @@ namespace jui
         sf::Vector2f findCharacterPos(int p_index) const;
         int findIndex(const sf::Vector2f& p_position) const;
     private:
+        // Mark the geometry as outdated, so the canvas lays it out before the next frame.
+        void requestLayout();
+        // Mark only the characters between the unchanged start and end of the string as outdated, so just the lines around them are laid out again.
+        void requestLayout(int p_unchanged_prefix, int p_unchanged_suffix);
         void ensureGeometryUpdate() const;
         void draw() const override;
-        void addGlyphQuad(sf::VertexArray& p_vertices, const sf::Vector2f& p_position, const sf::Color& p_color, const sf::Glyph& p_glyph) const;
 
-        void applyHorizontalAlignment() const;
-        void applyVerticalAlignment() const;
-        sf::String applyOverflowType() const;
-        void applySelection() const;
-        void applyStringGeometry(const sf::String& p_string) const;
+        // Copy everything the layout depends on. Only call it on the main thread.
+        void prepareLayout(Layout& p_layout) const;
+        // Replace the geometry by a computed one. Only call it on the main thread.
+        void applyLayout(Geometry& p_geometry) const;
+
+        // The layout only depends on its arguments, so it can run on worker threads.
+        static void computeLayout(const Layout& p_layout, Geometry& p_geometry);
+        static void addGlyphQuad(sf::VertexArray& p_vertices, const sf::Vector2f& p_position, const sf::Color& p_color, const sf::Glyph& p_glyph);
+        static void applyHorizontalAlignment(const Layout& p_layout, Geometry& p_geometry, int p_first_line, int p_end_line);
+        static void applyVerticalAlignment(const Layout& p_layout, Geometry& p_geometry);
+        static sf::String applyOverflowType(const Layout& p_layout, const Geometry& p_geometry);
+        static void applySelection(const Layout& p_layout, Geometry& p_geometry);
+        static void applyStringGeometry(const Layout& p_layout, const sf::String& p_string, Geometry& p_geometry);
+        // Lay out the lines around an edit of the string again, and move the lines after them. Returns false if the whole text needs to be laid out.
+        static bool applyStringEdit(const Layout& p_layout, Geometry& p_geometry);
+        // Append the lines of the string from the index on, which starts a line at the height p_y. Stops at the end of the string, or at the first line that is not wrapped and starts at p_stop_index or after. Returns the index it stopped at, and the height of the next line in p_y.
+        static int applyLines(const Layout& p_layout, const sf::String& p_string, int p_index, int p_stop_index, float& p_y, Geometry& p_geometry);
     };
 
     class Button : public Widget
@@ -210,12 +423,15 @@ namespace jui
         std::function<void()> f_event;
     public:
         TextField text;
+        // Changed colors are applied by updateLogic(). Call requestUpdate() when changing them on a button that is already shown.
         sf::Color highlight_color = sf::Color(100, 100, 100);
         sf::Color standard_color = sf::Color::White;
         sf::Color pressed_color = sf::Color(50, 50, 50);
     public:
         Button(Canvas& p_canvas, sf::Font& p_font);
 
+        const char* getTypeName() const override;
+
         void setPosition(const sf::Vector2f& p_position) override;
         void setSize(const sf::Vector2f& p_size) override;
 
@@ -257,6 +473,8 @@ namespace jui
     public:
         ScrollBar(Canvas& p_canvas, sf::Font& p_font, Orientation p_orientation); 
 
+        const char* getTypeName() const override;
+
         void setPosition(const sf::Vector2f& p_position) override;
         void setSize(const sf::Vector2f& p_size) override;
 
@@ -281,16 +499,66 @@ namespace jui
     /* A standard layout group that holds a list of pointers to widgets. It allows grouped movement, and layouting of the added widgets.*/
     class LayoutGroup : public Widget
     {
+        friend class Widget;
+        friend class Canvas;
     private:
         std::vector<Widget*> widget_list;
+
+        LayoutType layout = ManualLayout;
+        Orientation orientation = Vertical;
+        float spacing = 10.f;
+        float padding = 0.f;
+        int column_count = 2;
+        // The size of the widgets as arranged by the layout, cached until a widget changes its measured size. measure_valid is only false if the outermost group waits for its layout, see Widget::invalidateLayout().
+        sf::Vector2f measured_size;
+        bool measure_valid = true;
+        bool arrange_needed = false;
+        // Position in the canvas' list of groups waiting for their layout. -1 if the group is not in it.
+        int pending_arrange_position = -1;
+        // The bounds of all widgets, kept up to date while widgets are added, moved and resized. They are only calculated again from all widgets when a widget on their edge moved inwards or was removed.
+        mutable sf::FloatRect content_bounds;
+        mutable bool bounds_valid = true;
+        // The group moves all of its widgets itself and updates the bounds at once afterwards.
+        bool moving_widgets = false;
+
+        void refreshBounds(const sf::FloatRect& p_old_bounds, const sf::FloatRect& p_new_bounds);
+        void growBounds(const sf::FloatRect& p_bounds);
+
+        // Measure the widgets as the layout arranges them, including the padding.
+        sf::Vector2f measureWidgets();
+        // Move and resize the widgets to their place in the group, and arrange the groups among them whose size or widgets changed.
+        void arrangeWidgets();
+        // Give the widget its place, and arrange it if it is a group with a layout that changed.
+        void placeWidget(Widget* p_widget, const sf::Vector2f& p_position, const sf::Vector2f& p_size);
+        // Let a group removed from this group wait for its own layout, if it waited for the layout of this group.
+        void releaseWidget(Widget* p_widget);
     public:
         LayoutGroup(Canvas& p_canvas);
+        ~LayoutGroup();
+
+        const char* getTypeName() const override;
 
         void setPosition(const sf::Vector2f& p_position) override;
+        void setSize(const sf::Vector2f& p_size) override;
+        // The size of the bounds of all widgets. Takes O(1), except after widgets on the edge were removed or moved inwards.
         sf::Vector2f getGroupSize() const;
 
         void listWidgets(Orientation p_orientation, float p_spacing = 10.f);
 
+        /*
+        Arrange the widgets automatically, like a form or a toolbar. The group measures its widgets and arranges them again before the next frame, whenever widgets are added or removed or change their preferred, min or max size. Groups can be nested, the outermost group takes its preferred size or the size of its content.
+        StackLayout puts the widgets in a row or column with their measured size. WrapLayout starts a new row or column where the group ends. GridLayout puts them into the cells of a grid with setColumnCount() columns. FlexLayout stretches the widgets along the orientation by their flex grow factors or shrinks them down to their min size, and stretches them across the orientation to the size of the group.
+        */
+        void setLayout(LayoutType p_type, Orientation p_orientation = Vertical, float p_spacing = 10.f);
+        LayoutType getLayout() const;
+        void setColumnCount(int p_count);
+        // Space between the border of the group and its widgets.
+        void setPadding(float p_padding);
+        // Measure and arrange the widgets now, instead of before the next frame.
+        void updateLayout();
+        sf::Vector2f measure() override;
+        void invalidateLayout() override;
+
         void setMask(Widget* p_widget) override;
         void setVisible(bool p_state) override;
         void setUpdated(bool p_state) override;
@@ -299,8 +567,33 @@ namespace jui
 
         void add(Widget* p_widget);
         void remove(Widget* p_widget);
+        // Remove all widgets from the group.
+        void clear();
         Widget* get(int p_index);
-        int getCount();
+        int getCount() const;
+    };
+
+    /*
+    A Fenwick tree over a list of values, e.g. the heights of the items of a virtual ScrollList. Changing a value, summing up the values before an index and finding the index a sum is reached at all take O(log n).
+    */
+    class PrefixSums
+    {
+    private:
+        // Sums are added up in double precision, so the offsets of millions of items stay exact enough.
+        std::vector<double> tree;
+        std::vector<float> values;
+    public:
+        // Replace all values. Takes O(n).
+        void assign(const std::vector<float>& p_values);
+        void set(int p_index, float p_value);
+        float get(int p_index) const;
+        int getSize() const;
+
+        // Get the sum of all values before the index.
+        double getPrefix(int p_index) const;
+        double getTotal() const;
+        // Get the index of the value the sum reaches p_offset in, e.g. the item at an offset in a list. Offsets outside of the sum give the first or last index, an empty tree gives -1.
+        int find(double p_offset) const;
     };
 
     class ScrollList : public Widget
@@ -310,8 +603,26 @@ namespace jui
         LayoutGroup content;
 
         float scrollbar_width = 20.f;
+
+        // A virtual list only has widgets for the rows that are shown, see setVirtualItems().
+        bool is_virtual = false;
+        PrefixSums item_heights;
+        std::function<float(int)> f_itemHeight;
+        std::function<Widget*()> f_createRow;
+        std::function<void(Widget*, int)> f_bindRow;
+        // The rows showing the items from first_item on in order, and the rows that are not needed at the moment.
+        std::vector<Widget*> rows;
+        std::vector<Widget*> spare_rows;
+        int first_item = 0;
+        // How many rows are kept above and below the visible ones, so scrolling a little does not need to bind rows.
+        int overscan = 2;
+        // How far the list is scrolled down in pixels.
+        float scroll_offset = 0.f;
     public:
         ScrollList(Canvas& p_canvas, sf::Font& p_font);
+        ~ScrollList();
+
+        const char* getTypeName() const override;
 
         void setPosition(const sf::Vector2f& p_position) override;
         void setSize(const sf::Vector2f& p_size) override;
@@ -323,6 +634,8 @@ namespace jui
 
         void add(Widget* p_widget);
         void remove(Widget* p_widget);
+        // Remove all widgets from the list at once, which is faster than removing them one by one.
+        void clear();
         Widget* get(int p_index);
         int getCount();
 
@@ -331,7 +644,31 @@ namespace jui
 
         void listWidgets(Orientation orientation);
 
+        /*
+        Show a list of items without a widget for each of them. Only the rows in view and a few more exist. They are bound to other items while scrolling, so a list with a million items scrolls as fast as a short one. Do not use add(), remove() and listWidgets() on a virtual list.
+        @param p_count The number of items.
+        @param p_height Get the height of an item.
+        @param p_create_row Create a widget for a row. The list owns it and deletes it.
+        @param p_bind_row Show an item in a row, e.g. by setting its text. The row's size is set by the list.
+        */
+        void setVirtualItems(int p_count, const std::function<float(int)>& p_height, const std::function<Widget*()>& p_create_row, const std::function<void(Widget*, int)>& p_bind_row);
+        // Call this when items were added or removed, or all of them changed. The heights of all items are queried again and all rows are bound again.
+        void setItemCount(int p_count);
+        // Call this when an item changed. Its height is queried again and its row is bound again, if it is shown.
+        void refreshItem(int p_index);
+        int getItemCount() const;
+        bool isVirtual() const;
+        // Scroll until the item is at the top of the list, or as close as possible.
+        void scrollToItem(int p_index);
+        // Set how many rows are kept above and below the visible rows.
+        void setOverscan(int p_rows);
+
         void updateEvents(sf::Event& p_event) override;
+    private:
+        // Get the length of the content, which the scroll bar scrolls through.
+        float getContentLength() const;
+        // Bind the rows to the items in view and move them to their positions. Rows already showing an item in view keep it.
+        void refreshRows();
     };
 
     class DropDownList : public Widget
@@ -340,12 +677,16 @@ namespace jui
         Button dropdown_button;
         ScrollList scrolllist;
         sf::Font& font;
+        // The list is virtual, so only the visible elements have buttons.
+        std::vector<sf::String> elements;
 
         std::function<void()> f_onSelect;
         std::function<void()> f_onDeselect;
     public:
         DropDownList(Canvas& p_canvas, sf::Font& p_font);
 
+        const char* getTypeName() const override;
+
         void setPosition(const sf::Vector2f& p_position) override;
         void setSize(const sf::Vector2f& p_size) override;
 
@@ -418,11 +759,15 @@ namespace jui
 
         float blinking_timer = 0.f;
         float blinking_interval = 0.5f;
+        // Measures the time since the last update, as the field is not updated every frame.
+        sf::Clock blinking_clock;
 
         float text_padding = 5.f;
     public:
         InputField(Canvas& p_canvas, sf::Font& p_font);
 
+        const char* getTypeName() const override;
+
         void setPosition(const sf::Vector2f& p_position) override;
         void setSize(const sf::Vector2f& p_size) override;
         void setString(const sf::String& p_string);
@@ -459,15 +804,208 @@ namespace jui
     };
 
     /*
-    A canvas draws, updates the logic, the events, and handles the layout of widgets. A canvas needs a reference to a window in order to know where it has to draw its widgets.
+    Collects quads and draws them with as few draw calls as possible. Quads are clipped to a clip rectangle while they are added, so widgets do not need their own views for clipping. Consecutive quads share a draw call as long as their texture does not change.
     */
-    class Canvas
+    class QuadBatch
+    {
+    public:
+        struct Statistics
+        {
+            int draw_calls = 0;
+            int quads = 0;
+        };
+    private:
+        sf::RenderTarget* target;
+        std::vector<sf::Vertex> vertices;
+        const sf::Texture* texture = nullptr;
+        // Whether the texture has a white texel at (1, 1). SFML reserves such a texel in every font texture, so untextured quads can be drawn with it as well.
+        bool texture_has_white_texel = false;
+        Statistics statistics;
+        sf::BlendMode blend_mode = sf::BlendAlpha;
+
+        // All quads are clipped to the scissor rectangle as well, if there is one.
+        sf::FloatRect scissor;
+        bool has_scissor = false;
+
+        // While measuring, quads are not drawn, only the bounds of all clipped quads are collected.
+        bool is_measuring = false;
+        sf::FloatRect measured_bounds;
+    public:
+        QuadBatch(sf::RenderTarget& p_target);
+
+        // Add an untextured quad.
+        void addRectangle(const sf::FloatRect& p_rectangle, const sf::Color& p_color, const sf::FloatRect& p_clip);
+        // Add a textured quad. Set p_white_texel if the texture has a white texel at (1, 1) like all font textures.
+        void addTexturedRectangle(const sf::FloatRect& p_rectangle, const sf::FloatRect& p_texture_rect, const sf::Texture* p_texture, const sf::Color& p_color, const sf::FloatRect& p_clip, bool p_white_texel = false);
+        // Add the axis-aligned quads of a vertex array made up from triangles, 6 vertices per quad, moved by an offset.
+        void addQuads(const sf::VertexArray& p_vertices, const sf::Vector2f& p_offset, const sf::Texture* p_texture, const sf::FloatRect& p_clip, bool p_white_texel = false);
+        // Draw all quads added so far with the target's current view.
+        void flush();
+        // Flushes the batch and draws to another target from now on.
+        void setTarget(sf::RenderTarget& p_target);
+        sf::RenderTarget& getTarget() const;
+        // Flushes the batch if the blend mode changes.
+        void setBlendMode(const sf::BlendMode& p_blend_mode);
+
+        void setScissor(const sf::FloatRect& p_rectangle);
+        void removeScissor();
+
+        // Start collecting the bounds of the quads added, instead of drawing them.
+        void beginMeasure();
+        // Stop measuring and get the bounds of all quads added since beginMeasure().
+        sf::FloatRect endMeasure();
+
+        const Statistics& getStatistics() const;
+        void resetStatistics();
+    private:
+        // Make sure the next quad can be added to the current draw call.
+        void useTexture(const sf::Texture* p_texture, bool p_white_texel);
+    };
+
+    /*
+    A fixed set of worker threads for work that can be split into independent jobs. run() spreads the jobs over the workers and the calling thread, and returns when all of them are done.
+    */
+    class WorkerPool
+    {
+    private:
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable work_available;
+        std::condition_variable work_done;
+        // The jobs of the current call to run(). Every thread takes the next job index until none are left.
+        const std::function<void(int)>* job = nullptr;
+        int job_count = 0;
+        std::atomic<int> next_job;
+        int busy_workers = 0;
+        // Increased by every call to run(), so the workers know there is new work.
+        unsigned int generation = 0;
+        bool stopping = false;
+    public:
+        WorkerPool(unsigned int p_thread_count);
+        ~WorkerPool();
+
+        // Call p_job once for every index from 0 to p_job_count - 1. Blocks until all calls returned.
+        void run(int p_job_count, const std::function<void(int)>& p_job);
+        unsigned int getThreadCount() const;
+    private:
+        void work();
+        void runJobs();
+    };
+
+    /*
+    Tells the widgets of a canvas about the input they ask for between events: where the mouse is, which mouse buttons are held down, and how the mouse cursor should look. Derive from it to feed a canvas input from somewhere else than a window, e.g. a UI drawn into a texture that is shown inside a game scene.
+    */
+    class InputSource
     {
     public:
+        virtual ~InputSource() = default;
+
+        // Called with every event the canvas receives, before the widgets get it.
+        virtual void handleEvent(const sf::Event& p_event);
+        // Get the mouse position in pixels of the canvas' render target.
+        virtual sf::Vector2i getMousePosition() const = 0;
+        virtual bool isMouseButtonPressed(sf::Mouse::Button p_button) const = 0;
+        // Change the look of the mouse cursor, if there is one.
+        virtual void setMouseCursor(sf::Cursor::Type p_type);
+    };
+
+    /*
+    Reads the real mouse of a window.
+    */
+    class WindowInput : public InputSource
+    {
+    private:
         sf::RenderWindow& window;
+    public:
+        WindowInput(sf::RenderWindow& p_window);
 
-        std::vector<Widget*> widget_list;
+        sf::Vector2i getMousePosition() const override;
+        bool isMouseButtonPressed(sf::Mouse::Button p_button) const override;
+        void setMouseCursor(sf::Cursor::Type p_type) override;
+    };
+
+    /*
+    Only knows what the events given to the canvas tell, so it works without a window. Useful for canvases drawing into textures and for synthetic events, e.g. in benchmarks. Event positions need to be in pixels of the render target.
+    */
+    class EventInput : public InputSource
+    {
+    private:
+        sf::Vector2i mouse_position;
+        bool mouse_buttons[sf::Mouse::ButtonCount] = {};
+    public:
+        void handleEvent(const sf::Event& p_event) override;
+        sf::Vector2i getMousePosition() const override;
+        bool isMouseButtonPressed(sf::Mouse::Button p_button) const override;
+    };
+
+    /*
+    A canvas draws, updates the logic, the events, and handles the layout of widgets. A canvas needs a reference to a render target in order to know where it has to draw its widgets, usually a window. Its input source tells the widgets where the mouse is on that target.
+    */
+    class Canvas
+    {
+        friend class Widget;
+        friend class TextField;
+        friend class LayoutGroup;
+    public:
+        sf::RenderTarget& target;
+
+        // What the canvas measured for a widget, or for all widgets of a type, while profiling. Times are in milliseconds and summed up since profiling was enabled or reset.
+        struct Profile
+        {
+            // nullptr for the profile of a type.
+            const Widget* widget = nullptr;
+            const char* type = "";
+            float draw_time = 0.f;
+            float logic_time = 0.f;
+            float event_time = 0.f;
+            int draw_count = 0;
+            int logic_count = 0;
+            int event_count = 0;
+            // How often a TextField rebuilt its geometry, and how often the view and clipped bounds of the widget were refreshed.
+            int geometry_rebuilds = 0;
+            int view_refreshes = 0;
+
+            float getTotalTime() const;
+        };
     private:
+        // A slot links a widget to its neighbours in the list of its layer. Removing a widget only clears the widget of its slot. The slot stays linked until compact() is called once per frame, so the lists can be iterated while widgets are destroyed or moved, e.g. by a click event.
+        struct Slot
+        {
+            Widget* widget = nullptr;
+            int previous = -1;
+            int next = -1;
+            int layer = 0;
+        };
+        // All slots of one layer in the order the widgets were moved to it.
+        struct Layer
+        {
+            int first = -1;
+            int last = -1;
+        };
+        std::vector<Slot> slots;
+        // The state of the widget in each slot the per-frame passes need, in arrays next to the slots. Culling the widgets runs through these arrays instead of following the pointers to all widgets. Kept up to date by refreshSlot().
+        enum SlotFlags
+        {
+            SlotVisible = 1 << 0,
+            SlotSelectable = 1 << 1
+        };
+        std::vector<unsigned char> slot_flags;
+        // The clipped bounds and overflow bounds of the widget in one rectangle.
+        std::vector<sf::FloatRect> slot_bounds;
+        // The slots of the widgets drawn in this frame, in drawing order. Kept to avoid allocations.
+        std::vector<int> draw_list;
+        // Slots that can be reused.
+        std::vector<int> free_slots;
+        // Slots whose widget was removed, but which are still linked.
+        std::vector<int> removed_slots;
+        // Layers are sorted in ascending order, which is the order the widgets are drawn in.
+        std::map<int, Layer> layers;
+        int widget_count = 0;
+        // Greater than 0 while the canvas iterates over its widgets. Slots must not be unlinked then.
+        int iteration_depth = 0;
+
+        QuadBatch batch;
+
         Widget* selected_widget = nullptr;
         Widget* hovered_widget = nullptr;
         
@@ -476,8 +1014,80 @@ namespace jui
 
         static float s_delta_time;
         sf::Clock clock;
+
+        // Hit-testing uses a uniform grid over the window. Each cell stores the visible and selectable widgets whose clipped bounds overlap the cell, so finding the widget under the mouse only has to look at a handful of widgets.
+        static const int s_hit_cell_size = 64;
+        int hit_grid_columns = 0;
+        int hit_grid_rows = 0;
+        std::vector<std::vector<Widget*>> hit_grid;
+        unsigned int layer_order_counter = 0;
+
+        // With partial redraws the last frame is kept, and only the dirty region is drawn again. The dirty region is made up from rectangles that do not overlap.
+        bool partial_redraw = false;
+        sf::RenderTexture frame;
+        std::vector<sf::FloatRect> dirty_region;
+        // Widgets that changed since the last frame. They are measured before the next frame to find out where they are drawn now. Removed widgets are replaced by nullptr.
+        std::vector<Widget*> invalidated_widgets;
+        // More rectangles than this are combined into one.
+        static const int s_max_dirty_rects = 16;
+
+        // For every event category, the widgets that receive all of its events. Removed widgets are replaced by nullptr until the next call to compact(). One for each EventCategory, like Widget::subscriber_positions.
+        static const int s_event_category_count = 7;
+        std::vector<Widget*> global_subscribers[s_event_category_count];
+        // The widgets an event is currently sent to. Removed widgets are replaced by nullptr, so they are skipped.
+        std::vector<Widget*> event_targets;
+
+        // Widgets whose logic is updated once in the next frame, and widgets whose logic is updated every frame. Removed widgets are replaced by nullptr.
+        std::vector<Widget*> update_queue;
+        std::vector<Widget*> every_frame_widgets;
+        // Widgets that scheduled an update, and the clock their update times refer to. The widgets form a binary min-heap ordered by their update time, so the next update due is always the first.
+        std::vector<Widget*> scheduled_widgets;
+        sf::Clock timer_clock;
+        // Whether a widget changed since the last call to drawAll().
+        bool redraw_needed = true;
+        // How long run() sleeps at most between looking for new events while it waits for a scheduled update, in milliseconds.
+        static const int s_poll_interval = 5;
+
+        // The profiles of all widgets, and the summed up profiles of the types of removed widgets.
+        bool profiling = false;
+        std::unordered_map<const Widget*, Profile> widget_profiles;
+        std::map<std::string, Profile> removed_type_profiles;
+        int profiled_frames = 0;
+
+        // The widgets refreshClipping() still has to clip. Kept to avoid allocations.
+        std::vector<Widget*> clip_stack;
+
+        // All cached widgets, and the memory their cache textures use in bytes.
+        std::vector<Widget*> cached_widgets;
+        std::size_t cache_memory = 0;
+        std::size_t cache_budget = 64 * 1024 * 1024;
+        // Counts the frames drawn, so caches know when they were used the last time.
+        unsigned int frame_counter = 0;
+        // Widgets with an anchor, which are moved when the size of the canvas changes.
+        std::vector<Widget*> anchored_widgets;
+        bool applying_anchors = false;
+        // Resize events are merged, the canvas adapts to the last size once, when it is needed.
+        bool resize_pending = false;
+        // The outermost LayoutGroups whose widgets changed. They are arranged before the next frame is drawn, before the text fields are laid out.
+        std::vector<LayoutGroup*> pending_arranges;
+        // Text fields whose layout changed. They are laid out in parallel before the next frame is drawn.
+        std::vector<TextField*> pending_layouts;
+        // The visible ones of them laid out in this frame. Kept to avoid allocations.
+        std::vector<TextField*> visible_layouts;
+        // Waking up the workers has a cost as well, so fewer text fields are laid out on the main thread.
+        static const int s_min_parallel_layouts = 16;
+        unsigned int layout_thread_count = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+        std::unique_ptr<WorkerPool> layout_pool;
+        // The window the canvas draws to, or nullptr if it draws to another render target.
+        sf::RenderWindow* window = nullptr;
+        InputSource* input;
+        // The input source created by the canvas if none was given.
+        std::unique_ptr<InputSource> own_input;
     public:
+        // Draw to the window and read the mouse of the window.
         Canvas(sf::RenderWindow& p_window);
+        // Draw to any render target, e.g. a render texture. Without an input source the canvas only uses the events it receives. The input source needs to stay alive as long as the canvas.
+        Canvas(sf::RenderTarget& p_target, InputSource* p_input = nullptr);
 
         void drawAll();
         void updateAllLogic();
@@ -486,24 +1096,154 @@ namespace jui
         void add(Widget* p_widget);
         void remove(Widget* p_widget);
 
-        // Changes the position of the widget in the widget_list, therefore changing its drawing order. This won't apply the given layer to the widget. Use Widget::setLayer().
+        // Moves the widget behind the last widget of the given layer, therefore changing its drawing order. This won't apply the given layer to the widget. Use Widget::setLayer().
         void moveToLayer(Widget* p_widget, int p_layer);
+        // Get the number of widgets added to this canvas.
+        int getWidgetCount() const;
     
         // Get a pointer to the selected widget. If nothing is selected, nullptr is returned.
         Widget* getSelected();
         // Get a pointer to the top most widget the mouse is currently hovering over.
         Widget* getHovered();
+        // Get a pointer to the top most visible and selectable widget at the given position in window coordinates. If there is none, nullptr is returned.
+        Widget* findWidgetAt(const sf::Vector2f& p_position) const;
         // Get the view of this canvas.
         const sf::View& getView() const;
+        // Get the batch all widgets are drawn with. Its statistics show how many draw calls the last drawAll() needed.
+        QuadBatch& getBatch();
+        // The whole area of the canvas in window coordinates.
+        sf::FloatRect getBounds() const;
+        // Get the input source the widgets read the mouse from.
+        InputSource& getInput();
+        // Get the current mouse position in canvas coordinates.
+        sf::Vector2f getMousePosition() const;
+        // Adapt the canvas to a new size of its render target, and move the anchored widgets. This is done once after any number of sf::Event::Resized, before the next frame or the next other event. A canvas drawing to a render texture needs this after the texture was created again with another size.
+        void refreshSize();
+
+        // With partial redraws drawAll() only redraws the widgets that intersect areas which changed since the last frame. The last frame is kept in a texture, which is then drawn to the window at once. Mostly static UIs get a lot cheaper to draw this way.
+        void setPartialRedraw(bool p_state);
+        bool isPartialRedraw() const;
+        // Mark an area in window coordinates to be redrawn by the next partial redraw.
+        void invalidate(const sf::FloatRect& p_area);
+        // Get the area the next partial redraw is going to draw. If it is empty, nothing changed since the last frame, so the window does not need to be drawn and displayed again.
+        const std::vector<sf::FloatRect>& getDirtyRegion();
+
+        // Limit the memory used by the textures of all cached widgets in bytes. If a cache does not fit anymore, the caches used the longest time ago are released. Widgets without a cache are drawn as usual.
+        void setCacheBudget(std::size_t p_bytes);
+        std::size_t getCacheBudget() const;
+        std::size_t getCacheMemory() const;
 
         void select(Widget* p_widget);
 
-        void print();
+        // Set how many worker threads lay out changed text fields in parallel at the start of drawAll(), besides the main thread. With 0 every text field is laid out on the main thread. By default one less than the number of cores.
+        void setLayoutThreads(unsigned int p_count);
+        unsigned int getLayoutThreads() const;
+
+        // Whether drawing the canvas again would show something new, because a widget changed since the last call to drawAll(), widgets still need to be updated, or widgets are updated every frame. Apps that only draw when this is true use no CPU while nobody uses them.
+        bool needsRedraw() const;
+        // Get the time until the next update a widget scheduled is due. Zero if the canvas needs to be redrawn right away, negative if nothing is scheduled.
+        sf::Time getTimeUntilUpdate() const;
+        // Run the main loop of the window with on-demand rendering: sleep until an event arrives or a scheduled update is due, handle all pending events, update the logic and only draw and display the window if needsRedraw() is true. 
+        // Events are passed to p_on_event first, if it is set. The window is closed on sf::Event::Closed. Keep a framerate limit or vertical sync, so widgets updated every frame do not run faster than the screen.
+        void run(const std::function<void(sf::Event&)>& p_on_event = nullptr, const sf::Color& p_clear_color = sf::Color::White);
+
+        // Measure how long draw(), updateLogic() and updateEvents() take for every widget, and count how often widgets rebuild their geometry or refresh their views. While disabled this costs nothing but a check per call.
+        void setProfiling(bool p_state);
+        bool isProfiling() const;
+        // Forget everything measured so far.
+        void resetProfile();
+        // Get the number of frames drawn since profiling was enabled or reset.
+        int getProfiledFrames() const;
+        // Get the profiles of the p_count widgets that took the most time, the most expensive first.
+        std::vector<Profile> getWidgetProfiles(std::size_t p_count) const;
+        // Get the profiles of the p_count widget types that took the most time, the most expensive first. Widgets that were removed while profiling are included.
+        std::vector<Profile> getTypeProfiles(std::size_t p_count) const;
+        // Print the p_count most expensive widget types and widgets to the console.
+        void printProfile(std::size_t p_count = 10) const;
 
         static float getDeltaTime();
     private:
-        // Find index of widget in list. If the widget is not stored, -1 is returned.
-        int find(Widget* p_widget) const;
+        // Link a new slot for the widget at the end of the list of the given layer.
+        void link(Widget* p_widget, int p_layer);
+        // Clear the widget's slot. The slot is unlinked by the next call to compact().
+        void unlink(Widget* p_widget);
+        // Unlink all removed slots and remove empty layers. Does nothing while the widgets are iterated.
+        void compact();
+        // Copy the state of the widget into the arrays of its slot.
+        void refreshSlot(const Widget* p_widget);
+
+        // Measure where the invalidated widgets are drawn now and add these areas to the dirty region.
+        void measureInvalidated();
+        // Draw the dirty region to the frame.
+        void redrawDirtyRegion();
+
+        // Request an update of the widget and all of its masks.
+        void requestUpdates(Widget* p_widget);
+        // Add the widget to the heap of scheduled widgets, or move it up after it scheduled an earlier update. Remove it from the heap.
+        void schedule(Widget* p_widget);
+        void unschedule(Widget* p_widget);
+        // Move the scheduled widget at the position up or down in the heap until its parent is due before it and its children after it.
+        void siftScheduledUp(int p_position);
+        void siftScheduledDown(int p_position);
+        void swapScheduled(int p_first, int p_second);
+
+        // Add the widget to the anchored widgets, or remove it.
+        void addAnchored(Widget* p_widget);
+        void removeAnchored(Widget* p_widget);
+        // Add the widget to the cached widgets, or remove it.
+        void addCached(Widget* p_widget);
+        void removeCached(Widget* p_widget);
+        // Adapt to a size of the target that changed since the last resize event, if there was one.
+        void applyPendingResize();
+        // Add the group to the groups waiting for their layout, or remove it.
+        void requestArrange(LayoutGroup* p_group);
+        void cancelArrange(LayoutGroup* p_group);
+        // Arrange all groups waiting for their layout.
+        void arrangeLayoutGroups();
+        // Add the text field to the text fields waiting to be laid out, or remove it.
+        void requestLayout(TextField* p_text_field);
+        void cancelLayout(TextField* p_text_field);
+        // Lay out all visible text fields waiting for it, on the worker threads if there are enough of them. The results are applied on the main thread once all of them are done, before anything is drawn, so the canvas knows where the text fields draw to.
+        void layoutTextFields();
+        // Get the profile of the widget. Only call while profiling.
+        Profile& getProfile(const Widget* p_widget);
+        // Add the measurements of p_other to p_profile.
+        static void addProfile(Profile& p_profile, const Profile& p_other);
+        // Sort the profiles by their total time, the most expensive first, and only keep the first p_count.
+        static std::vector<Profile> sortProfiles(std::vector<Profile>& p_profiles, std::size_t p_count);
+        // Call a method of the widget and add the time it took to the given time of its profile while profiling.
+        template<typename F>
+        void profileCall(Widget* p_widget, float Profile::* p_time, int Profile::* p_count, F p_call);
+
+        // Wait for the next event of the window, but at most for the given time. A negative time waits until an event arrives. Returns false if no event arrived.
+        bool waitEvent(sf::Event& p_event, sf::Time p_timeout);
+
+        // Clip the widget and then, top-down, the widgets masked to it. The widgets masked to a widget whose clipped bounds did not change are skipped, unless p_force is set.
+        void refreshClipping(Widget* p_widget, bool p_force);
+
+        // Get the category of an event type as EventCategory flag.
+        static unsigned int getEventCategory(sf::Event::EventType p_type);
+        // Get the index of an EventCategory flag in the list of global subscribers.
+        static int getEventCategoryIndex(unsigned int p_category);
+
+        // Put the slots of the visible widgets drawing into the area into the draw list, in drawing order. Only the arrays of the slots are looked at, except for the masks of the widgets in the area if p_mask is set. Then only p_mask and the widgets masked to it, also through other masks, are put into the list.
+        void collectDrawList(const sf::FloatRect& p_area, Widget* p_mask = nullptr);
+        // Draw all widgets of the draw list with drawWidget().
+        void drawDrawList(Widget* p_limit = nullptr);
+        // Draw a widget, its cache, or nothing if it is drawn with the cache of one of its masks. Only caches below p_limit in the chain of masks are used.
+        void drawWidget(Widget* p_widget, Widget* p_limit = nullptr);
+        // Get the outermost mask of the widget, or the widget itself, that has a cache usable this frame. Only masks below p_limit are checked.
+        Widget* findCache(Widget* p_widget, Widget* p_limit = nullptr) const;
+        // Draw the caches of all visible cached widgets that changed since they were drawn.
+        void refreshCaches();
+        void renderCache(Widget* p_widget);
+        void releaseCache(Widget* p_widget);
+
+        // Register the widget in the hit grid cells its clipped bounds overlap, or unregister it if it is not visible or selectable anymore.
+        void refreshHitGrid(Widget* p_widget);
+        void removeFromHitGrid(Widget* p_widget);
+        // Resize the hit grid to the window and unregister all widgets.
+        void resetHitGrid();
     };
 
     /*
@@ -545,6 +1285,18 @@ namespace jui
             }
             return true;
         }
+        // Add an item that was loaded elsewhere, e.g. on another thread. The handler takes ownership of it.
+        bool add(Identifier p_identifier, Item* p_item)
+        {
+            auto inserted = m_resourceTable.insert(std::make_pair(p_identifier, p_item));
+            if(inserted.second == false)
+            {
+                std::wcerr << L"ResourceHandler: Added resource twice." << std::endl;
+                delete p_item;
+                return false;
+            }
+            return true;
+        }
         Item& get(Identifier p_identifier)
         {
             auto search = m_resourceTable.find(p_identifier);
@@ -559,16 +1311,80 @@ namespace jui
         }
     };
 
+    // The metrics of the glyphs of a font at one character size that were asked for through Fonts. Code points below 256 are looked up directly in an array, all others in a map.
+    struct GlyphTable
+    {
+        sf::Glyph latin1[256];
+        bool latin1_loaded[256] = {};
+        std::unordered_map<sf::Uint32, sf::Glyph> others;
+        // The size of the atlas texture when the glyphs were last read from the font.
+        sf::Vector2u texture_size;
+
+        // Get the glyph, or nullptr if it was not asked for yet.
+        const sf::Glyph* find(sf::Uint32 p_code_point) const;
+    };
+
     /*
     A static class for fast and simple font loading and accessing. Fonts are heavy objects and therefore should only be loaded once in the lifetime of a program.
+    A glyph is rasterized into the atlas texture of its font the first time it is needed at a character size, which can make the frame a new screen or a dropdown list appears in stutter. Fonts can be loaded on another thread and their glyphs rasterized ahead of time, e.g. while a loading screen is shown.
     */
     class Fonts
     {
+    public:
+        // A range of code points, including first and last.
+        struct GlyphRange
+        {
+            sf::Uint32 first;
+            sf::Uint32 last;
+        };
+        // How the atlas of a font at one character size is used. Only glyphs requested through Fonts are known, which includes all glyphs of text fields.
+        struct AtlasStatistics
+        {
+            unsigned int character_size = 0;
+            int glyph_count = 0;
+            // The area the glyphs cover in the atlas texture in pixels, including the padding SFML leaves around each glyph.
+            std::size_t glyph_area = 0;
+            sf::Vector2u texture_size;
+            // Glyphs text fields needed before they were rasterized, so they were rasterized while a frame was drawn.
+            int misses = 0;
+
+            // Get the share of the atlas texture covered by glyphs, from 0 to 1.
+            float getFill() const;
+        };
     private:
+        struct Atlas
+        {
+            AtlasStatistics statistics;
+            GlyphTable glyphs;
+        };
         static ResourceHandler<std::string, sf::Font> s_fontTable;
+        // Fonts still loading on other threads. Guards the font table, which is changed by these threads.
+        static std::map<std::string, std::shared_future<bool>> s_loading;
+        static std::mutex s_mutex;
+        static std::map<std::pair<const sf::Font*, unsigned int>, Atlas> s_atlases;
+        // SFML leaves this many pixels free around each glyph in the atlas.
+        static const int s_glyph_padding = 2;
     public:
         static bool load(const std::string& p_name, const std::string& p_filePath);
+        // Load the font on another thread. The future tells whether it was loaded. get() waits for a font that is still loading.
+        static std::shared_future<bool> loadAsync(const std::string& p_name, const std::string& p_filePath);
         static sf::Font& get(const std::string& p_name);
+
+        // Rasterize the glyphs of all ranges at all character sizes, so text fields do not need to do it while drawing. Only call it on the main thread, since it updates the atlas textures.
+        static void prewarm(const sf::Font& p_font, const std::vector<unsigned int>& p_sizes, const std::vector<GlyphRange>& p_ranges);
+        // Get a glyph like sf::Font::getGlyph() does, and count it as a miss if it was not rasterized yet. Only call it on the main thread.
+        static const sf::Glyph& getGlyph(const sf::Font& p_font, sf::Uint32 p_code_point, unsigned int p_character_size);
+        // Get all glyphs of the font at the character size that were asked for through Fonts. Text fields look their glyphs up in it and only ask getGlyph() for the missing ones. Only call it on the main thread.
+        static const GlyphTable& getGlyphTable(const sf::Font& p_font, unsigned int p_character_size);
+        // Get the statistics of the atlases of the font at all character sizes it was used with.
+        static std::vector<AtlasStatistics> getAtlasStatistics(const sf::Font& p_font);
+        // Read the glyphs of the font at all character sizes again, e.g. after another font was assigned to it. Only call it on the main thread.
+        static void reloadGlyphTables(const sf::Font& p_font);
+        static void resetMisses();
+    private:
+        static const sf::Glyph& loadGlyph(const sf::Font& p_font, sf::Uint32 p_code_point, unsigned int p_character_size, bool p_count_miss);
+        // Read the glyphs from the font again if its atlas texture changed since they were read.
+        static void refreshGlyphTable(const sf::Font& p_font, unsigned int p_character_size, GlyphTable& p_table);
     };
 
     class Cursor
@@ -616,6 +1432,11 @@ namespace jui
     */
     bool mouseOverRectangle(const sf::FloatRect& rectangle, sf::RenderWindow& window, sf::View* view = nullptr);
 
+    /*
+    Get the smallest rectangle that contains both rectangles. Rectangles without an area are ignored.
+    */
+    sf::FloatRect combineRectangles(const sf::FloatRect& p_first, const sf::FloatRect& p_second);
+
     /*
     Split a string by some character.
     */